@@ -0,0 +1,118 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// Ping-pong one byte over many socketpairs at once. Each connection flips
+// between read and write interest on every round trip.
+// Usage: b03-pingpong [-e] [-r] [NPAIRS [NROUNDS]]; -e selects
+// init_epoll_et. -r puts a relay in front of each ponger, so the relay's
+// client side stays idle while it waits on its backend, as in a proxy;
+// this is the case where level-triggered epoll re-registers every fd.
+
+int npairs = 1000;
+int nrounds = 1000;
+bool relay = false;
+
+tamed void pong(tamer::fd f, tamer::fd backend) {
+    tvars { char c; size_t x; int ret; }
+    while (true) {
+        twait { f.read(&c, 1, x, make_event(ret)); }
+        if (ret != 0 || x != 1) {
+            break;
+        }
+        if (backend) {
+            twait { backend.write(&c, 1, x, make_event(ret)); }
+            twait { backend.read(&c, 1, x, make_event(ret)); }
+        }
+        twait { f.write(&c, 1, x, make_event(ret)); }
+    }
+    backend.close();
+}
+
+tamed void ping(tamer::fd f, tamer::event<> done) {
+    tvars { char c = 'x'; size_t x; int ret; int i; }
+    for (i = 0; i != nrounds; ++i) {
+        twait { f.write(&c, 1, x, make_event(ret)); }
+        twait { f.read(&c, 1, x, make_event(ret)); }
+        if (ret != 0 || x != 1) {
+            fprintf(stderr, "ping: %s\n", strerror(-ret));
+            break;
+        }
+    }
+    f.close();
+    done();
+}
+
+tamed void run() {
+    tvars { tamer::rendezvous<> r; int i, sv[2]; double t0;
+            tamer::driver_stats stats; }
+    for (i = 0; i != npairs; ++i) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+            perror("socketpair");
+            exit(1);
+        }
+        tamer::fd a(sv[0]), b(sv[1]), backend;
+        a.make_nonblocking();
+        b.make_nonblocking();
+        if (relay) {
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+                perror("socketpair");
+                exit(1);
+            }
+            tamer::fd c(sv[1]);
+            backend = tamer::fd(sv[0]);
+            backend.make_nonblocking();
+            c.make_nonblocking();
+            pong(c, tamer::fd());
+        }
+        pong(b, backend);
+        ping(a, make_event(r));
+    }
+    t0 = tamer::dnow();
+    twait(r);
+    stats = tamer::driver::main->stats();
+    printf("%d pairs, %d rounds: %.6f s, %llu adds, %llu mods, %llu dels\n",
+           npairs, nrounds, tamer::dnow() - t0,
+           (unsigned long long) stats.fd_adds,
+           (unsigned long long) stats.fd_mods,
+           (unsigned long long) stats.fd_dels);
+}
+
+int main(int argc, char** argv) {
+    int flags = tamer::init_tamer;
+    if (argc > 1 && strcmp(argv[1], "-e") == 0) {
+        flags |= tamer::init_epoll_et;
+        --argc, ++argv;
+    }
+    if (argc > 1 && strcmp(argv[1], "-r") == 0) {
+        relay = true;
+        --argc, ++argv;
+    }
+    if (argc > 1) {
+        npairs = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        nrounds = atoi(argv[2]);
+    }
+    tamer::initialize(flags);
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
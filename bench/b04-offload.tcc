@@ -0,0 +1,99 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <tamer/tamer.hh>
+#include <tamer/offload.hh>
+#include "../ex/md5.h"
+
+// Measure loop latency while hashing with MD5. A 1ms ticker records how
+// late each tick fires; meanwhile NJOBS buffers of SIZE bytes are hashed,
+// either inline in the loop or with tamer::offload.
+// Usage: b04-offload [-o] [NJOBS [SIZE]]; -o offloads the hashing.
+
+int njobs = 200;
+int size = 1 << 20;
+bool use_offload = false;
+bool done = false;
+
+unsigned hash(const std::vector<unsigned char>* buf) {
+    md5_state_t st;
+    md5_byte_t digest[16];
+    md5_init(&st);
+    md5_append(&st, buf->data(), buf->size());
+    md5_finish(&st, digest);
+    unsigned x;
+    memcpy(&x, digest, sizeof(x));
+    return x;
+}
+
+tamed void ticker() {
+    tvars { double expected, late, total = 0, max = 0; int n = 0; }
+    while (!done) {
+        expected = tamer::dnow() + 0.001;
+        twait { tamer::at_delay(0.001, make_event()); }
+        late = tamer::dnow() - expected;
+        total += late;
+        max = late > max ? late : max;
+        ++n;
+    }
+    printf("%d ticks, lateness mean %.6f s, max %.6f s\n",
+           n, n ? total / n : 0, max);
+}
+
+tamed void run() {
+    tvars {
+        std::vector<unsigned char> buf(size, 'x');
+        std::vector<unsigned> results(njobs);
+        double t0;
+        int i;
+    }
+    t0 = tamer::dnow();
+    if (use_offload) {
+        twait {
+            for (i = 0; i != njobs; ++i) {
+                tamer::offload([&buf] { return hash(&buf); },
+                               make_event(results[i]));
+            }
+        }
+    } else {
+        for (i = 0; i != njobs; ++i) {
+            twait { tamer::at_asap(make_event()); }
+            results[i] = hash(&buf);
+        }
+    }
+    done = true;
+    printf("%s: %d x %d bytes in %.6f s\n", use_offload ? "offload" : "inline",
+           njobs, size, tamer::dnow() - t0);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "-o") == 0) {
+        use_offload = true;
+        --argc, ++argv;
+    }
+    if (argc > 1) {
+        njobs = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        size = atoi(argv[2]);
+    }
+    tamer::initialize();
+    ticker();
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
@@ -0,0 +1,70 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tamer/tamer.hh>
+
+// Timeout churn: NCONN simulated connections each make NROUNDS requests.
+// Every request arms an idle timeout and a request timeout, and completes
+// long before either fires; the connection then cancels both timers by
+// triggering their events.
+// Usage: b05-timers [-w] [NCONN [NROUNDS]]; -w selects init_timer_wheel.
+
+int nconn = 100000;
+int nrounds = 20;
+
+tamed void conn(tamer::event<> done) {
+    tvars { tamer::rendezvous<> r; tamer::event<> idle, req; int i; }
+    for (i = 0; i != nrounds; ++i) {
+        idle = make_event(r);
+        req = make_event(r);
+        tamer::at_delay(60.0, idle);
+        tamer::at_delay(30.0, req);
+        twait { tamer::at_asap(make_event()); }
+        req.trigger();
+        idle.trigger();
+        r.clear();
+    }
+    done();
+}
+
+tamed void run() {
+    tvars { tamer::rendezvous<> r; int i; double t0; }
+    t0 = tamer::dnow();
+    for (i = 0; i != nconn; ++i) {
+        conn(make_event(r));
+    }
+    twait(r);
+    printf("%d conns, %d rounds: %.6f s\n", nconn, nrounds,
+           tamer::dnow() - t0);
+}
+
+int main(int argc, char** argv) {
+    int flags = tamer::init_tamer;
+    if (argc > 1 && strcmp(argv[1], "-w") == 0) {
+        flags |= tamer::init_timer_wheel;
+        --argc, ++argv;
+    }
+    if (argc > 1) {
+        nconn = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        nrounds = atoi(argv[2]);
+    }
+    tamer::initialize(flags);
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
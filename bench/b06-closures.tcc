@@ -0,0 +1,50 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <tamer/tamer.hh>
+
+// Calls to a tamed function that returns without blocking: each call
+// allocates and frees a closure. Compile with -DTAMER_NOCLOSUREPOOL=1 to
+// compare against the standard allocator.
+
+tamed void add(int& x, int y, tamer::event<> e) {
+    x += y;
+    e.trigger();
+}
+
+tamed void run(int n, tamer::event<> done) {
+    tvars { int i, x = 0; }
+    for (i = 0; i != n; ++i) {
+        twait { add(x, i, make_event()); }
+    }
+    if (x == 1) {
+        printf("%d\n", x);
+    }
+    done.trigger();
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 10000000;
+    tamer::initialize();
+    double t0 = tamer::dnow();
+    tamer::rendezvous<> r;
+    tamer::event<> done = tamer::make_event(r);
+    run(n, done);
+    while (done) {
+        tamer::once();
+    }
+    printf("%d calls: %.6f s\n", n, tamer::dnow() - t0);
+    tamer::cleanup();
+}
@@ -0,0 +1,69 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <tamer/coro.hh>
+
+// Per-suspension cost of a tamed function and of a plain C++20 coroutine
+// that co_awaits the same events through <tamer/coro.hh>. Each iteration
+// blocks once on an at_asap event.
+
+tamed void tamed_loop(int n, tamer::event<> done) {
+    tvars { int i; }
+    for (i = 0; i != n; ++i) {
+        twait { tamer::at_asap(make_event()); }
+    }
+    done.trigger();
+}
+
+tamer::task task_loop(int n, tamer::event<> done) {
+    for (int i = 0; i != n; ++i) {
+        co_await tamer::asap();
+    }
+    done.trigger();
+}
+
+tamer::task rendezvous_loop(int n, tamer::event<> done) {
+    tamer::rendezvous<> r;
+    for (int i = 0; i != n; ++i) {
+        tamer::at_asap(tamer::make_event(r));
+        co_await r;
+    }
+    done.trigger();
+}
+
+template <typename F>
+void run(const char* name, int n, F f) {
+    tamer::rendezvous<> r;
+    tamer::event<> done = tamer::make_event(r);
+    double t0 = tamer::dnow();
+    f(n, done);
+    while (done) {
+        tamer::once();
+    }
+    double t = tamer::dnow() - t0;
+    printf("%-10s %d suspensions: %.6f s, %.1f ns/suspension\n",
+           name, n, t, t * 1e9 / n);
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 5000000;
+    tamer::initialize();
+    run("tamed", n, [](int n, tamer::event<> done) {
+            tamed_loop(n, std::move(done));
+        });
+    run("task", n, task_loop);
+    run("rendezvous", n, rendezvous_loop);
+    tamer::cleanup();
+}
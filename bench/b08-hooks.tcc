@@ -0,0 +1,59 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <tamer/tamer.hh>
+
+// Events with stacked at_trigger hooks. Each iteration waits on a readable
+// pipe with a timer and a user at_trigger, so the event carries the
+// timer's hook, the user's hook, and the driver's fd hook.
+
+int nhooks;
+
+void count_hook(void*) {
+    ++nhooks;
+}
+
+tamed void run(int fd, int n, tamer::event<> done) {
+    tvars { int i; tamer::event<> e; }
+    for (i = 0; i != n; ++i) {
+        twait {
+            e = make_event();
+            tamer::at_delay(1, e);
+            e.at_trigger(tamer::fun_event(count_hook, (void*) 0));
+            tamer::at_fd_read(fd, e);
+        }
+    }
+    done.trigger();
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    int p[2];
+    if (pipe(p) != 0 || write(p[1], "x", 1) != 1) {
+        perror("pipe");
+        return 1;
+    }
+    tamer::initialize();
+    double t0 = tamer::dnow();
+    tamer::rendezvous<> r;
+    tamer::event<> done = tamer::make_event(r);
+    run(p[0], n, done);
+    while (done) {
+        tamer::once();
+    }
+    printf("%d waits, %d hooks: %.6f s\n", n, nhooks, tamer::dnow() - t0);
+    tamer::cleanup();
+}
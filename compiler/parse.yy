@@ -156,6 +156,11 @@ fn_specifiers: /* empty */		{ $$ = fn_specifier_t(); }
             $1.template_[which] = $4.str();
             $$ = $1;
         }
+	| fn_specifiers '[' passthroughs ']' {
+	    if (!$1.add_attributes($3.str()))
+		yyerror("bad tamed function attribute; expected hot(vars)");
+	    $$ = $1;
+	}
 	;
 
 /* declaration_specifiers is no longer optional ?! */
@@ -1,5 +1,6 @@
 #include "tame.hh"
 #include <ctype.h>
+#include <algorithm>
 
 const lstr::size_type lstr::npos;
 
@@ -122,6 +123,60 @@ str var_t::decl(bool include_name) const
     return b.str();
 }
 
+// Size of a closure member with a known scalar type, or 0. Members
+// with scalar types are trivially destructible, so they may be moved.
+unsigned var_t::scalar_size() const
+{
+    if (_arrays.length() || _type.arrays().length())
+        return 0;
+    if (_type.pointer().length())
+        return sizeof(void*);
+    strbuf b;
+    std::istringstream is(_type.base_type());
+    str word;
+    while (is >> word)
+        if (word != "const" && word != "volatile")
+            b << (b.str().empty() ? "" : " ")
+              << (word.compare(0, 5, "std::") == 0 ? word.substr(5) : word);
+    str t = b.str();
+    static const struct { const char* name; unsigned size; } sizes[] = {
+        {"bool", 1}, {"char", 1}, {"signed char", 1}, {"unsigned char", 1},
+        {"int8_t", 1}, {"uint8_t", 1},
+        {"short", 2}, {"unsigned short", 2}, {"int16_t", 2}, {"uint16_t", 2},
+        {"int", 4}, {"unsigned", 4}, {"unsigned int", 4}, {"signed", 4},
+        {"float", 4}, {"int32_t", 4}, {"uint32_t", 4},
+        {"long", sizeof(long)}, {"unsigned long", sizeof(long)},
+        {"long long", 8}, {"unsigned long long", 8}, {"double", 8},
+        {"int64_t", 8}, {"uint64_t", 8}, {"size_t", sizeof(size_t)},
+        {"ssize_t", sizeof(size_t)}, {"intptr_t", sizeof(void*)},
+        {"uintptr_t", sizeof(void*)}, {"off_t", 8}, {"time_t", sizeof(long)}
+    };
+    for (auto& s : sizes)
+        if (t == s.name)
+            return s.size;
+    return 0;
+}
+
+bool fn_specifier_t::add_attributes(const str& s)
+{
+    // hot(a, b, ...): lay out these closure variables first
+    str x = ws_strip(s);
+    if (x.compare(0, 3, "hot") != 0)
+        return false;
+    x = ws_strip(x.substr(3));
+    if (x.length() < 2 || x[0] != '(' || x[x.length() - 1] != ')')
+        return false;
+    std::istringstream is(x.substr(1, x.length() - 2));
+    str name;
+    while (std::getline(is, name, ',')) {
+        name = ws_strip(name);
+        if (name.empty())
+            return false;
+        hot_.push_back(name);
+    }
+    return !hot_.empty();
+}
+
 str var_t::param_decl(bool move, bool escape) const
 {
     strbuf b;
@@ -152,6 +207,37 @@ str var_t::name(bool move, bool escape) const
         return _name;
 }
 
+// Argument expression that passes this parameter on to another function.
+str var_t::forward() const
+{
+    const str& p = _type.pointer();
+    if (_arrays.empty()
+        && (p.empty()
+            || (p.length() >= 2 && p.compare(p.length() - 2, 2, "&&") == 0)))
+        return "std::move(" + _name + ")";
+    else
+        return _name;
+}
+
+// Declaration of this variable as a local, with its initializer.
+str var_t::local_decl() const
+{
+    strbuf b;
+    b << _type.to_str() << " " << _name << _arrays;
+    if (_initializer) {
+        _initializer->finish_type(b);
+        // "T x ()" value-initializes in a closure, but declares a function
+        strbuf ib;
+        _initializer->initializer(ib, false);
+        str i = ib.str();
+        if (i.find_first_not_of("() \t\n") == str::npos && i.length())
+            b << "{}";
+        else
+            b << i;
+    }
+    return b.str();
+}
+
 str var_t::ref_decl(bool noref) const {
     strbuf b;
     const char* refit;
@@ -296,6 +382,7 @@ tame_fn_t::tame_fn_t(const fn_specifier_t &fn, const str &r, declarator_t *d,
       _lbrace_lineno(0),
       _vars(NULL),
       _after_vars_el_encountered(false) {
+    _hot = fn.hot_;
     the_closure_[0] = the_closure_[1] = 0;
     if ((_class.empty() || template_args(_class).empty())
         && !fn.template_[0].empty())
@@ -658,11 +745,12 @@ str type_t::mangle() const
     return mangler(to_str()).s();
 }
 
-void vartab_t::closure_declarations(strbuf& b, const str& padding) const
+// tamer::destroy_guard objects need special initialization
+static bool is_destroy_guard(const var_t& v)
 {
-    for (unsigned i = 0; i != size(); ++i)
-        if (!_vars[i].name().empty())
-            b << padding << _vars[i].decl(true) << ";\n";
+    return v.initializer()
+        && (v.type().base_type() == "tamer::destroy_guard"
+            || v.type().base_type() == "destroy_guard");
 }
 
 void
@@ -684,10 +772,7 @@ vartab_t::initializers_and_reference_declarations(strbuf& b, outputter_t* o,
         if (init)
             init->finish_type(b);
         b << ")";
-        // tamer::destroy_guard objects need special initialization
-        if (fn && init
-            && (v.type().base_type() == "tamer::destroy_guard"
-                || v.type().base_type() == "destroy_guard"))
+        if (fn && is_destroy_guard(v))
             b << "(" TAME_CLOSURE_NAME ", " << init->value() << ")";
         else if (init)
             init->initializer(b, v.type().is_ref());
@@ -696,6 +781,26 @@ vartab_t::initializers_and_reference_declarations(strbuf& b, outputter_t* o,
     }
 }
 
+void
+vartab_t::local_declarations(outputter_t* o) const
+{
+    for (unsigned i = 0; i != size(); ++i) {
+        const var_t& v = _vars[i];
+        if (v.name().empty())
+            continue;
+        initializer_t* init = v.initializer();
+        strbuf b;
+        if (is_destroy_guard(v))
+            b << "  " << v.type().to_str() << " " << v.name()
+              << "(" TAME_CLOSURE_NAME ", " << init->value() << ");\n";
+        else
+            b << "  " << v.local_decl() << ";\n";
+        unsigned lineno = init ? init->constructor_lineno() : 0;
+        o->switch_to_mode(OUTPUT_TREADMILL, lineno ? int(lineno) : -1);
+        o->output_str(b.str());
+    }
+}
+
 void
 vartab_t::paramlist(strbuf &b, paramlist_flags list_mode, const char* sep) const
 {
@@ -720,6 +825,12 @@ vartab_t::paramlist(strbuf &b, paramlist_flags list_mode, const char* sep) const
               << "(" << (_vars[i].type().is_ref() ? "&" : "")
               << _vars[i].name(true, false) << ");\n";
             break;
+        case pl_coroutine_declarations:
+            b << _vars[i].param_decl(false, false);
+            break;
+        case pl_forward:
+            b << _vars[i].forward();
+            break;
         default:
             assert(false);
             break;
@@ -840,13 +951,48 @@ tame_fn_t::output_closure(outputter_t *o)
 
     if (_class.length() && !(_opts & STATIC_DECL))
         b << "  " << _self.decl(true) << ";\n";
+    // Layout: hot variables, then other variables in declaration order,
+    // then the implicit rendezvous, then scalars by decreasing size.
+    // Members are destroyed in reverse layout order, so only trivially
+    // destructible variables move: scalars past the rendezvous, and hot
+    // variables (checked by static_assert) ahead of everything else.
+    std::vector<const var_t*> vars, scalars;
     if (_args)
-        _args->closure_declarations(b, "    ");
-    _stack_vars.closure_declarations(b, "    ");
+        for (auto& v : _args->_vars)
+            if (!v.name().empty())
+                vars.push_back(&v);
+    for (auto& v : _stack_vars._vars)
+        if (!v.name().empty())
+            vars.push_back(&v);
+    for (auto& h : _hot) {
+        auto it = std::find_if(vars.begin(), vars.end(),
+                               [&](const var_t* v) { return v->name() == h; });
+        if (it == vars.end()) {
+            yyerror("hot variable " + h + " not found in " + _name);
+            continue;
+        }
+        b << "    " << (*it)->decl(true) << ";\n"
+          << "    static_assert(std::is_trivially_destructible<decltype("
+          << h << ")>::value, \"hot variable " << h
+          << " must be trivially destructible\");\n";
+        vars.erase(it);
+    }
+    for (auto v : vars)
+        if (v->scalar_size())
+            scalars.push_back(v);
+        else
+            b << "    " << v->decl(true) << ";\n";
 
     if (need_implicit_rendezvous())
         b << "  tamer::gather_rendezvous " TWAIT_BLOCK_RENDEZVOUS ";\n";
 
+    std::stable_sort(scalars.begin(), scalars.end(),
+                     [](const var_t* a, const var_t* b) {
+                         return a->scalar_size() > b->scalar_size();
+                     });
+    for (auto v : scalars)
+        b << "    " << v->decl(true) << ";\n";
+
     b << "};\n\n";
 
     o->output_str(b.str());
@@ -921,6 +1067,60 @@ tame_fn_t::closure_signature() const
     return b.str();
 }
 
+// The coroutine overload takes a tag argument first, and only named
+// parameters, without their defaults.
+str
+tame_fn_t::coroutine_signature() const
+{
+    strbuf b;
+    if (class_template_.length() || function_template_.length())
+        add_templates(b, " ");
+    if ((_opts & STATIC_DECL) && !_class.length())
+        b << "static ";
+    b << "tamer::tamerpriv::coroutine " << _name
+      << "(tamer::tamerpriv::coroutine_tag";
+    if (_args)
+        _args->paramlist(b, vartab_t::pl_coroutine_declarations, ", ");
+    b << ")";
+    if (_isconst)
+        b << " const";
+    return b.str();
+}
+
+bool
+tame_fn_t::may_be_coroutine() const
+{
+    return tamer_coroutines && _ret_type.is_void();
+}
+
+bool
+tame_fn_t::needs_closure_reference() const
+{
+    for (auto& v : _stack_vars._vars)
+        if (is_destroy_guard(v))
+            return true;
+    return false;
+}
+
+void
+tame_fn_t::output_coroutine_firstfn(outputter_t *o)
+{
+    state->set_fn(this);
+    output_mode_t om = o->switch_to_mode(OUTPUT_PASSTHROUGH);
+
+    strbuf b;
+    b << signature() << "\n{\n"
+      << "  " << (_class.length() ? _method_name : _name);
+    add_template_function_args(b);
+    b << "(tamer::tamerpriv::coroutine_tag()";
+    if (_args)
+        _args->paramlist(b, vartab_t::pl_forward, ", ");
+    b << ");\n}\n";
+
+    o->output_str(b.str());
+    o->switch_to_mode(om);
+}
+
 void
 tame_fn_t::output_firstfn(outputter_t *o)
 {
@@ -934,9 +1134,13 @@ tame_fn_t::output_firstfn(outputter_t *o)
     b << signature() << "\n{\n";
 
     b << "  " << closure(true).decl(true) << " = "
-      << "std::allocator< " << closure(true).type().base_type() << " >()."
-      << "allocate(1);\n"
-      << "  ((" << closure_type << "::tamer_closure_type*) " TAME_CLOSURE_NAME ")->initialize_closure("
+      << "tamer::tamerpriv::allocate_closure< "
+      << closure(true).type().base_type() << " >();\n";
+    if (tamer_report_closure_sizes)
+        b << "  static tamer::tamerpriv::closure_size_note tamer_closure_size_note_(\""
+          << _name << "\", \"" << _loc << "\", sizeof("
+          << closure(true).type().base_type() << "));\n";
+    b << "  ((" << closure_type << "::tamer_closure_type*) " TAME_CLOSURE_NAME ")->initialize_closure("
       << closure(true).type().base_type() << "::tamer_activator_";
     if (_class.length() && !(_opts & STATIC_DECL))
         b << ", this";
@@ -962,7 +1166,15 @@ tame_fn_t::output_fn(outputter_t *o)
     state->set_fn(this);
 
     output_mode_t om = o->switch_to_mode(OUTPUT_PASSTHROUGH);
-    b << closure_signature() << "\n{\n";
+    if (is_coroutine()) {
+        b << coroutine_signature() << "\n{\n";
+        if (need_implicit_rendezvous())
+            b << "  tamer::gather_rendezvous " TWAIT_BLOCK_RENDEZVOUS ";\n";
+        if (needs_closure_reference())
+            b << "  tamer::tamerpriv::closure& " TAME_CLOSURE_NAME
+                " = co_await tamer::tamerpriv::this_closure();\n";
+    } else
+        b << closure_signature() << "\n{\n";
 
     o->output_str(b.str());
 
@@ -988,6 +1200,13 @@ tame_fn_t::output_vars(outputter_t *o, int ln)
     strbuf b;
     output_mode_t om = o->switch_to_mode(OUTPUT_TREADMILL, ln);
 
+    if (is_coroutine()) {
+        // arguments and tvars are ordinary locals of the coroutine
+        _stack_vars.local_declarations(o);
+        o->switch_to_mode(om);
+        return;
+    }
+
     if (_args)
         _args->reference_declarations(b, "  ");
     b << "  tamer::tamerpriv::closure_owner<" << closure_type_name(true)
@@ -1006,19 +1225,28 @@ void
 tame_fn_t::output(outputter_t *o)
 {
     strbuf b;
-    if (!_class.length() || _declaration_only) {
+    // A declaration cannot tell whether its definition will be a
+    // coroutine, so it declares both overloads when it might be.
+    bool coro = is_coroutine();
+    if (!coro && (!_class.length() || _declaration_only)) {
         if (!function_template_.empty())
             b << "template < " << function_template_ << " > ";
         b << "class " << closure(false).type().base_type() << ";";
     }
     if (_declaration_only)
         b << " " << signature() << ";";
-    if (!_class.length())
+    if (!coro && !_class.length())
         b << " " << closure_signature() << ";";
+    if ((coro || (_declaration_only && may_be_coroutine()))
+        && !_class.length())
+        b << " " << coroutine_signature() << ";";
     str bstr = b.str();
     if (bstr.length())
         o->output_str(bstr + "\n");
-    if (!_declaration_only) {
+    if (coro) {
+        output_coroutine_firstfn(o);
+        output_fn(o);
+    } else if (!_declaration_only) {
         output_closure(o);
         output_firstfn(o);
         output_fn(o);
@@ -1037,17 +1265,20 @@ tame_block_ev_t::output(outputter_t *o)
 {
   strbuf b;
   str tmp;
+  bool coro = _fn->is_coroutine();
+  // coroutines keep the implicit rendezvous in a local
+  str rv = coro ? TWAIT_BLOCK_RENDEZVOUS : TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS;
 
   b << "/*twait{*/ do { ";
   b << "do {\n";
   if (tamer_debug) {
-      b << "#define make_event(...) make_annotated_event(__FILE__, __LINE__, " TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ", ## __VA_ARGS__)\n"
-        << "#define make_preevent(...) make_annotated_preevent(__FILE__, __LINE__, " TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ", ## __VA_ARGS__)\n";
+      b << "#define make_event(...) make_annotated_event(__FILE__, __LINE__, " << rv << ", ## __VA_ARGS__)\n"
+        << "#define make_preevent(...) make_annotated_preevent(__FILE__, __LINE__, " << rv << ", ## __VA_ARGS__)\n";
   } else {
-      b << "#define make_event(...) make_event(" TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ", ## __VA_ARGS__)\n"
-        << "#define make_preevent(...) make_preevent(" TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ", ## __VA_ARGS__)\n";
+      b << "#define make_event(...) make_event(" << rv << ", ## __VA_ARGS__)\n"
+        << "#define make_preevent(...) make_preevent(" << rv << ", ## __VA_ARGS__)\n";
   }
-  b << "    tamer::tamerpriv::rendezvous_owner<tamer::gather_rendezvous> " TWAIT_BLOCK_RENDEZVOUS "_holder(" TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ");\n";
+  b << "    tamer::tamerpriv::rendezvous_owner<tamer::gather_rendezvous> " TWAIT_BLOCK_RENDEZVOUS "_holder(" << rv << ");\n";
   o->output_str(b.str());
 
   output_mode_t om = o->switch_to_mode(OUTPUT_TREADMILL);
@@ -1065,16 +1296,26 @@ tame_block_ev_t::output(outputter_t *o)
   int lineno = o->lineno();
   o->switch_to_mode(OUTPUT_TREADMILL, lineno);
   b << "/*}twait*/ " TWAIT_BLOCK_RENDEZVOUS "_holder.reset(); } while (0); ";
-  b << "  if (" TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ".has_waiting()) {\n"
-    << "    " TAME_CLOSURE_NAME ".set_location(__FILE__, __LINE__);\n";
-  if (!description_empty(description_) && tamer_debug)
-      b << "    " TAME_CLOSURE_NAME ".set_description((" << description_ << "));\n";
-  b << _fn->label(_id) << ":\n"
-    << "    if (" TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ".has_waiting()) {\n"
-    << "        " TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ".block(" TAME_CLOSURE_NAME ", " << _id << ");\n"
-    << "        tamer_closure_holder_.reset();\n"
-    << "        " << _fn->return_expr() << "; }}\n"
-    << "  } while (0);\n";
+  if (coro) {
+      b << "  while (" << rv << ".has_waiting())\n"
+        << "    co_await tamer::tamerpriv::coroutine_block(" << rv << ", "
+        << _id << ", __FILE__, __LINE__";
+      if (!description_empty(description_) && tamer_debug)
+          b << ", (" << description_ << ")";
+      b << ");\n"
+        << "  } while (0);\n";
+  } else {
+      b << "  if (" TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ".has_waiting()) {\n"
+        << "    " TAME_CLOSURE_NAME ".set_location(__FILE__, __LINE__);\n";
+      if (!description_empty(description_) && tamer_debug)
+          b << "    " TAME_CLOSURE_NAME ".set_description((" << description_ << "));\n";
+      b << _fn->label(_id) << ":\n"
+        << "    if (" TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ".has_waiting()) {\n"
+        << "        " TAME_CLOSURE_NAME "." TWAIT_BLOCK_RENDEZVOUS ".block(" TAME_CLOSURE_NAME ", " << _id << ");\n"
+        << "        tamer_closure_holder_.reset();\n"
+        << "        " << _fn->return_expr() << "; }}\n"
+        << "  } while (0);\n";
+  }
   o->output_str(b.str());
   o->switch_to_mode(OUTPUT_PASSTHROUGH);
   o->output_str("\n#undef make_event\n#undef make_preevent\n");
@@ -1125,6 +1366,11 @@ void
 parse_state_t::output (outputter_t *o)
 {
   o->start_output ();
+  if (tamer_coroutines) {
+      output_mode_t om = o->switch_to_mode(OUTPUT_TREADMILL);
+      o->output_str("#include <tamer/coro.hh>\n");
+      o->switch_to_mode(om);
+  }
   element_list_t::output (o);
 }
 
@@ -1148,18 +1394,29 @@ tame_wait_t::output (outputter_t *o)
 
     output_mode_t om = o->switch_to_mode(OUTPUT_TREADMILL);
     strbuf b;
-    b << _fn->label(_id) << ":\n";
+    if (!_fn->is_coroutine())
+        b << _fn->label(_id) << ":\n";
     b << "do {\n";
     o->set_lineno(lineno_, b);
-    b << "  if (!" << jgn << ".join (";
+    b << (_fn->is_coroutine() ? "  while (!" : "  if (!")
+      << jgn << ".join (";
     for (size_t i = 0; i < n_args (); i++) {
         if (i > 0) b << ", ";
         b << "" << arg (i).name () << "";
     }
-    b << ")) {\n";
-    output_blocked (b, jgn);
-    b << "  }\n"
-      << "} while (0);\n";
+    if (_fn->is_coroutine()) {
+        b << "))\n"
+          << "    co_await tamer::tamerpriv::coroutine_block(" << jgn << ", "
+          << _id << ", __FILE__, __LINE__";
+        if (!description_empty(description_) && tamer_debug)
+            b << ", (" << description_ << ")";
+        b << ");\n";
+    } else {
+        b << ")) {\n";
+        output_blocked (b, jgn);
+        b << "  }\n";
+    }
+    b << "} while (0);\n";
 
     o->output_str(b.str());
     o->switch_to_mode (om);
@@ -1179,7 +1436,11 @@ tame_ret_t::output (outputter_t *o)
   strbuf b;
 
   o->switch_to_mode (OUTPUT_PASSTHROUGH, _line_number);
-  b << "return";
+  // A return with a value can only belong to a lambda in a void function.
+  if (_fn->is_coroutine() && !_params.length())
+      b << "co_return";
+  else
+      b << "return";
   if (_params.length()) {
       b << " ";
       b << _params;
@@ -1196,7 +1457,8 @@ tame_fn_return_t::output (outputter_t *o)
   strbuf b;
   output_mode_t om = o->switch_to_mode (OUTPUT_TREADMILL);
 
-  b << "  " << _fn->return_expr () << ";\n";
+  if (!_fn->is_coroutine())
+      b << "  " << _fn->return_expr () << ";\n";
   o->output_str (b.str());
   o->switch_to_mode (om);
 }
@@ -6,9 +6,12 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <getopt.h>
 
 parse_state_t *state;
 bool tamer_debug = false;
+bool tamer_report_closure_sizes = false;
+bool tamer_coroutines = false;
 outputter_t *outputter;
 
 std::ostream &warn = std::cerr;
@@ -16,10 +19,14 @@ std::ostream &warn = std::cerr;
 static void
 usage ()
 {
-  warn  << "usage: tamer [-Lchnv] [-o <outfile>] [<infile>]\n"
+  warn  << "usage: tamer [-CLSchnv] [-o <outfile>] [<infile>]\n"
         << "\n"
         << "  Flags:\n"
         << "    -g  turn on debugging support\n"
+        << "    -S, --report-closure-sizes\n"
+        << "        report closure sizes when the program exits\n"
+        << "    -C, --coroutines\n"
+        << "        output blocking tamed functions as C++20 coroutines\n"
         << "    -n  turn on newlines in autogenerated code\n"
         << "    -L  disable line number translation\n"
         << "    -h  show this screen\n"
@@ -94,11 +101,24 @@ main (int argc, char *argv[])
   str ifn, depfile;
   bool c_mode (false), b_mode (false);
 
-  while ((ch = getopt (argc, argv, "bghlnDLvdo:c:O:F:")) != -1)
+  static const struct option long_options[] = {
+      { "report-closure-sizes", no_argument, 0, 'S' },
+      { "coroutines", no_argument, 0, 'C' },
+      { 0, 0, 0, 0 }
+  };
+
+  while ((ch = getopt_long (argc, argv, "bghlnCDLSvdo:c:O:F:",
+                            long_options, 0)) != -1)
     switch (ch) {
     case 'g':
         tamer_debug = true;
         break;
+    case 'S':
+        tamer_report_closure_sizes = true;
+        break;
+    case 'C':
+        tamer_coroutines = true;
+        break;
     case 'h':
         usage();
         break;
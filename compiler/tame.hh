@@ -373,7 +373,10 @@ public:
     void set_initializer(initializer_t* i) { _initializer = i; }
 
     str param_decl(bool move, bool escape) const;
+    str forward() const;
+    str local_decl() const;
     str decl(bool include_name) const;
+    unsigned scalar_size() const;
     str ref_decl(bool noref) const;
     void reference_declaration(strbuf& b, const str& padding) const;
     str _name;
@@ -395,11 +398,12 @@ public:
     ~vartab_t() {}
     size_t size() const { return _vars.size (); }
     bool add(const var_t &v);
-    void closure_declarations(strbuf& b, const str& padding) const;
     void reference_declarations(strbuf& b, const str& padding) const;
     void initializers_and_reference_declarations(strbuf& b, outputter_t* o,
                                                  tame_fn_t* fn) const;
-    typedef enum { pl_declarations, pl_assign_moves_named } paramlist_flags;
+    void local_declarations(outputter_t* o) const;
+    typedef enum { pl_declarations, pl_assign_moves_named,
+                   pl_coroutine_declarations, pl_forward } paramlist_flags;
     void paramlist(strbuf &b, paramlist_flags flags, const char* sep) const;
     bool exists(const str &n) const { return _tab.find(n) != _tab.end(); }
     const var_t *lookup(const str &n) const;
@@ -465,6 +469,9 @@ struct fn_specifier_t {
     fn_specifier_t() : _opts(0) { }
     unsigned _opts;
     str template_[2];
+    std::vector<str> hot_;      // closure variables laid out first
+
+    bool add_attributes(const str& s);
 };
 
 //
@@ -511,6 +518,7 @@ class tame_fn_t : public element_list_t {
     str name() const { return _name; }
     str closure_type_name(bool include_template) const;
     str closure_signature() const;
+    str coroutine_signature() const;
     str signature() const;
 
     void set_opts (int i) { _opts = i; }
@@ -529,6 +537,12 @@ class tame_fn_t : public element_list_t {
     }
 
     void hit_tame_block () { _n_blocks++; }
+    // true if this function is output as a C++20 coroutine; a function
+    // with no twait never suspends, so it stays a plain function
+    bool is_coroutine() const {
+        return may_be_coroutine() && !_declaration_only && _n_labels != 1
+            && !_default_return.length();
+    }
 
     str label(str s) const;
     str label(unsigned id) const ;
@@ -560,17 +574,21 @@ class tame_fn_t : public element_list_t {
     bool _declaration_only;
 
     var_t mk_closure(bool object, bool ref) const;
+    bool may_be_coroutine() const;
+    bool needs_closure_reference() const;
     void add_template_function_args(strbuf& buf) const;
 
     vartab_t *_args;
     vartab_t _stack_vars;
     std::vector<tame_env_t *> _envs;
+    std::vector<str> _hot;
 
     void output_reenter(strbuf &b);
     void output_closure(outputter_t *o);
     void output_firstfn(outputter_t *o);
     void output_fn(outputter_t *o);
     void output_jump_tab(strbuf &b);
+    void output_coroutine_firstfn(outputter_t *o);
     void output_block_cb_switch(strbuf &b);
 
     int _opts;
@@ -774,5 +792,7 @@ do {                                                      \
 } while (0)
 
 extern bool tamer_debug;
+extern bool tamer_report_closure_sizes;
+extern bool tamer_coroutines;
 
 #endif /* _TAME_TAME_H */
@@ -0,0 +1,460 @@
+#ifndef TAMER_CORO_HH
+#define TAMER_CORO_HH 1
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+#include <coroutine>
+#include <memory>
+#include <tuple>
+namespace tamer {
+
+/** @file <tamer/coro.hh>
+ *  @brief  Support for C++20 coroutines.
+ *
+ *  Source files translated with <tt>tamer --coroutines</tt> include this
+ *  file, and must be compiled as C++20. Ordinary C++20 coroutines can
+ *  include it too: a function returning tamer::task can <tt>co_await</tt>
+ *  rendezvous, events, timers, and fd operations without the
+ *  <tt>tamer</tt> preprocessor.
+ */
+
+namespace tamerpriv {
+
+struct coroutine_tag {
+};
+
+// A closure whose activator resumes a coroutine. Tamed coroutines block
+// through their closures, so rendezvous, drivers, tamed_class, and the
+// closure profiler treat them like other tamed functions.
+class coroutine_closure : public closure {
+  public:
+    std::coroutine_handle<> handle_;
+
+    static void activator(closure* c) {
+        coroutine_closure* cc = static_cast<coroutine_closure*>(c);
+        if (cc->tamer_block_position_ == (unsigned) -1) {
+            cc->handle_.destroy();
+        } else {
+            cc->handle_.resume();
+        }
+    }
+};
+
+// Promise state shared by tamed coroutines and tamer::task. The coroutine
+// starts immediately and frees itself when it returns; a blocked
+// coroutine is destroyed when its closure is killed. Frames come from the
+// closure pool.
+class coroutine_promise {
+  public:
+    std::suspend_never initial_suspend() const noexcept {
+        return std::suspend_never();
+    }
+    std::suspend_never final_suspend() const noexcept {
+        return std::suspend_never();
+    }
+    void return_void() const noexcept {
+    }
+    void unhandled_exception() const {
+        throw;
+    }
+
+    static void* operator new(size_t size) {
+        return allocate_closure_memory(size);
+    }
+    static void operator delete(void* p, size_t size) {
+        deallocate_closure_memory(p, size);
+    }
+
+    coroutine_closure closure_;
+};
+
+template <typename P>
+inline closure& coroutine_closure_of(std::coroutine_handle<P> h) {
+    return static_cast<coroutine_promise&>(h.promise()).closure_;
+}
+
+// Return type of a tamed function compiled as a coroutine.
+class coroutine {
+  public:
+    class promise_type : public coroutine_promise {
+      public:
+        template <typename... A>
+        promise_type(coroutine_tag, A&&...) {
+            closure_.initialize_closure(coroutine_closure::activator);
+        }
+        template <typename K, typename... A>
+        promise_type(K& self, coroutine_tag, A&&...) {
+            closure_.initialize_closure(coroutine_closure::activator,
+                                        std::addressof(self));
+        }
+
+        coroutine get_return_object() noexcept {
+            closure_.handle_ =
+                std::coroutine_handle<promise_type>::from_promise(*this);
+            return coroutine();
+        }
+    };
+};
+
+template <typename R>
+class coroutine_blocker {
+  public:
+    inline coroutine_blocker(R& r, unsigned position,
+                             const char* file, int line)
+        : r_(r), position_(position), file_(file), line_(line) {
+    }
+    inline bool await_ready() const noexcept {
+        return false;
+    }
+    template <typename P>
+    inline void await_suspend(std::coroutine_handle<P> h) {
+        closure& c = coroutine_closure_of(h);
+        c.set_location(file_, line_);
+        r_.block(c, position_);
+    }
+    inline void await_resume() const noexcept {
+    }
+  private:
+    R& r_;
+    unsigned position_;
+    const char* file_;
+    int line_;
+};
+
+template <typename R>
+class described_coroutine_blocker : public coroutine_blocker<R> {
+  public:
+    inline described_coroutine_blocker(R& r, unsigned position,
+                                       const char* file, int line,
+                                       std::string description)
+        : coroutine_blocker<R>(r, position, file, line),
+          description_(std::move(description)) {
+    }
+    template <typename P>
+    inline void await_suspend(std::coroutine_handle<P> h) {
+        coroutine_closure_of(h).set_description(description_);
+        coroutine_blocker<R>::await_suspend(h);
+    }
+  private:
+    std::string description_;
+};
+
+// co_await coroutine_block(r, ...) blocks the calling coroutine on r.
+template <typename R>
+inline coroutine_blocker<R> coroutine_block(R& r, unsigned position,
+                                            const char* file, int line) {
+    return coroutine_blocker<R>(r, position, file, line);
+}
+
+template <typename R>
+inline described_coroutine_blocker<R> coroutine_block(R& r, unsigned position,
+                                                      const char* file, int line,
+                                                      std::string description) {
+    return described_coroutine_blocker<R>(r, position, file, line,
+                                          std::move(description));
+}
+
+// co_await this_closure() returns the calling coroutine's closure.
+class this_closure {
+  public:
+    inline bool await_ready() const noexcept {
+        return false;
+    }
+    template <typename P>
+    inline bool await_suspend(std::coroutine_handle<P> h) noexcept {
+        c_ = &coroutine_closure_of(h);
+        return false;
+    }
+    inline closure& await_resume() const noexcept {
+        return *c_;
+    }
+  private:
+    closure* c_;
+};
+
+} // namespace tamerpriv
+
+/** @class task tamer/coro.hh <tamer/coro.hh>
+ *  @brief  Return type for C++20 coroutines that block on Tamer events.
+ *
+ *  A coroutine returning task starts running immediately and runs until
+ *  its first suspension; the caller then continues. The coroutine resumes
+ *  from the driver loop, like a tamed function, and frees itself when it
+ *  returns. Its frame is allocated from the closure pool.
+ *
+ *  A task that is a member function of a tamed_class is destroyed, wherever
+ *  it is blocked, when its object is destroyed. A task blocked on a
+ *  rendezvous is destroyed when that rendezvous is destroyed.
+ *
+ *  @code
+ *  tamer::task copy(tamer::fd in, tamer::fd out, tamer::event<> done) {
+ *      char buf[8192];
+ *      size_t n;
+ *      while (co_await tamer::read_once(in, buf, sizeof(buf), n) == 0
+ *             && n != 0) {
+ *          co_await tamer::write(out, buf, n);
+ *      }
+ *      done.trigger();
+ *  }
+ *  @endcode
+ */
+class task {
+  public:
+    class promise_type : public tamerpriv::coroutine_promise {
+      public:
+        promise_type() {
+            closure_.initialize_closure(tamerpriv::coroutine_closure::activator);
+        }
+        template <typename K, typename... A>
+        promise_type(K& self, A&&...) {
+            closure_.initialize_closure(tamerpriv::coroutine_closure::activator,
+                                        std::addressof(self));
+        }
+
+        task get_return_object() noexcept {
+            closure_.handle_ =
+                std::coroutine_handle<promise_type>::from_promise(*this);
+            return task();
+        }
+    };
+};
+
+namespace tamerpriv {
+
+template <typename I>
+class rendezvous_awaiter {
+  public:
+    inline rendezvous_awaiter(rendezvous<I>& r)
+        : r_(r) {
+    }
+    inline bool await_ready() {
+        return (joined_ = r_.join(eid_));
+    }
+    template <typename P>
+    inline void await_suspend(std::coroutine_handle<P> h) {
+        r_.block(coroutine_closure_of(h), 0);
+    }
+    inline I await_resume() {
+        if (!joined_) {
+            (void) r_.join(eid_);
+        }
+        return eid_;
+    }
+  private:
+    rendezvous<I>& r_;
+    I eid_ = I();
+    bool joined_;
+};
+
+template <>
+class rendezvous_awaiter<void> {
+  public:
+    inline rendezvous_awaiter(rendezvous<>& r)
+        : r_(r) {
+    }
+    inline bool await_ready() {
+        return (joined_ = r_.join());
+    }
+    template <typename P>
+    inline void await_suspend(std::coroutine_handle<P> h) {
+        r_.block(coroutine_closure_of(h), 0);
+    }
+    inline void await_resume() {
+        if (!joined_) {
+            (void) r_.join();
+        }
+    }
+  private:
+    rendezvous<>& r_;
+    bool joined_;
+};
+
+class gather_awaiter {
+  public:
+    inline gather_awaiter(gather_rendezvous& r)
+        : r_(r) {
+    }
+    inline bool await_ready() const {
+        return !r_.has_waiting();
+    }
+    template <typename P>
+    inline void await_suspend(std::coroutine_handle<P> h) {
+        r_.block(coroutine_closure_of(h), 0);
+    }
+    inline void await_resume() const noexcept {
+    }
+  private:
+    gather_rendezvous& r_;
+};
+
+template <typename... T>
+struct event_awaiter_result {
+    typedef std::tuple<T...> type;
+    static inline type get(std::tuple<T...>& vs) {
+        return std::move(vs);
+    }
+};
+
+template <typename T>
+struct event_awaiter_result<T> {
+    typedef T type;
+    static inline type get(std::tuple<T>& vs) {
+        return std::move(std::get<0>(vs));
+    }
+};
+
+template <>
+struct event_awaiter_result<> {
+    typedef void type;
+    static inline void get(std::tuple<>&) {
+    }
+};
+
+// Awaiting starts the operation by passing f an event; the coroutine
+// suspends only if that event has not triggered by the time f returns.
+template <typename F, typename... T>
+class event_awaiter {
+  public:
+    inline event_awaiter(F f)
+        : f_(std::move(f)) {
+    }
+    inline bool await_ready() {
+        std::apply([this](T&... x) {
+                f_(event<T...>(tamer::make_event(r_, x...)));
+            }, vs_);
+        return !r_.has_waiting();
+    }
+    template <typename P>
+    inline void await_suspend(std::coroutine_handle<P> h) {
+        r_.block(coroutine_closure_of(h), 0);
+    }
+    inline typename event_awaiter_result<T...>::type await_resume() {
+        return event_awaiter_result<T...>::get(vs_);
+    }
+  private:
+    F f_;
+    gather_rendezvous r_;
+    std::tuple<T...> vs_;
+};
+
+} // namespace tamerpriv
+
+/** @brief  Wait for an event on @a r from a coroutine.
+ *  @return  The ID of the triggered event.
+ *
+ *  <tt>co_await r</tt> is the coroutine equivalent of <tt>twait(r, eid)</tt>.
+ */
+template <typename I>
+inline tamerpriv::rendezvous_awaiter<I> operator co_await(rendezvous<I>& r) {
+    return tamerpriv::rendezvous_awaiter<I>(r);
+}
+
+/** @brief  Wait for all events on @a r from a coroutine. */
+inline tamerpriv::gather_awaiter operator co_await(gather_rendezvous& r) {
+    return tamerpriv::gather_awaiter(r);
+}
+
+/** @brief  Return an awaitable that waits for an event.
+ *  @param  f  Function object called with a fresh event<T...>.
+ *
+ *  <tt>co_await tamer::await<T...>(f)</tt> calls @a f with a new
+ *  event<T...>, then suspends the coroutine until that event is triggered
+ *  or dereferenced. The result is void, the single trigger value, or a
+ *  std::tuple of trigger values, depending on the number of types @a T.
+ *  The coroutine does not suspend if the event triggers before @a f
+ *  returns.
+ *
+ *  @code
+ *  int ret = co_await tamer::await<int>([&](tamer::event<int> e) {
+ *          f.read(buf, size, nread, e);
+ *      });
+ *  @endcode
+ */
+template <typename... T, typename F>
+inline tamerpriv::event_awaiter<F, T...> await(F f) {
+    return tamerpriv::event_awaiter<F, T...>(std::move(f));
+}
+
+/** @brief  Return an awaitable that resumes the coroutine after @a sec
+ *  seconds. */
+inline auto delay(double sec) {
+    return await<>([sec](event<> e) { at_delay(sec, std::move(e)); });
+}
+
+/** @brief  Return an awaitable that resumes the coroutine as soon as
+ *  possible. */
+inline auto asap() {
+    return await<>([](event<> e) { at_asap(std::move(e)); });
+}
+
+/** @brief  Return an awaitable that reads @a size bytes from @a f.
+ *  @return  The error code passed to fd::read's event.
+ *  @sa fd::read(void*, size_t, size_t&, event<int>) */
+inline auto read(fd f, void* buf, size_t size, size_t& nread) {
+    return await<int>([f, buf, size, &nread](event<int> e) mutable {
+            f.read(buf, size, nread, std::move(e));
+        });
+}
+
+/** @brief  Return an awaitable that reads at most @a size bytes from @a f.
+ *  @sa fd::read_once(void*, size_t, size_t&, event<int>) */
+inline auto read_once(fd f, void* buf, size_t size, size_t& nread) {
+    return await<int>([f, buf, size, &nread](event<int> e) mutable {
+            f.read_once(buf, size, nread, std::move(e));
+        });
+}
+
+/** @brief  Return an awaitable that writes @a size bytes to @a f.
+ *  @sa fd::write(const void*, size_t, size_t&, event<int>) */
+inline auto write(fd f, const void* buf, size_t size, size_t& nwritten) {
+    return await<int>([f, buf, size, &nwritten](event<int> e) mutable {
+            f.write(buf, size, nwritten, std::move(e));
+        });
+}
+
+/** @brief  Return an awaitable that writes @a size bytes to @a f.
+ *  @sa fd::write(const void*, size_t, event<int>) */
+inline auto write(fd f, const void* buf, size_t size) {
+    return await<int>([f, buf, size](event<int> e) mutable {
+            f.write(buf, size, std::move(e));
+        });
+}
+
+/** @brief  Return an awaitable that writes @a buf to @a f.
+ *  @sa fd::write(const std::string&, event<int>) */
+inline auto write(fd f, std::string buf) {
+    return await<int>([f, buf = std::move(buf)](event<int> e) mutable {
+            f.write(std::move(buf), std::move(e));
+        });
+}
+
+/** @brief  Return an awaitable that accepts a connection on @a f.
+ *  @return  The accepted fd, or a closed fd carrying an error code.
+ *  @sa fd::accept(event<fd>) */
+inline auto accept(fd f) {
+    return await<fd>([f](event<fd> e) mutable {
+            f.accept(std::move(e));
+        });
+}
+
+/** @brief  Return an awaitable that connects @a f to @a addr.
+ *  @sa fd::connect */
+inline auto connect(fd f, const struct sockaddr* addr, socklen_t addrlen) {
+    return await<int>([f, addr, addrlen](event<int> e) mutable {
+            f.connect(addr, addrlen, std::move(e));
+        });
+}
+
+} // namespace tamer
+#endif /* TAMER_CORO_HH */
@@ -13,38 +13,79 @@
  */
 #include "config.h"
 #include "dinternal.hh"
+#include <tamer/adapter.hh>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
 #include <sstream>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#if HAVE_SYS_EVENTFD_H
+# include <sys/eventfd.h>
+#endif
 
 namespace tamer {
 namespace tamerpriv {
-timeval recent;
-bool need_recent = true;
+thread_local timeval recent;
+thread_local uint64_t recent_nsec;
+thread_local bool need_recent = true;
 time_type_t time_type = time_normal;
-static timeval virtual_offset = { 1000000000, 0 };
+static uint64_t virtual_offset = uint64_t(1000000000) * 1000000000;
 simple_driver simple_driver::immediate_driver;
 } // namespace tamerpriv
 
-driver* driver::main;
+thread_local driver* driver::main;
 driver* driver::indexed[capacity];
 int driver::next_index;
 
 driver::driver() {
-    if (next_index < capacity) {
-        index_ = next_index;
-        ++next_index;
+    // drivers may be created concurrently by different threads
+    index_ = capacity;
+    if (__atomic_load_n(&next_index, __ATOMIC_RELAXED) < int(capacity)) {
+        index_ = __atomic_fetch_add(&next_index, 1, __ATOMIC_RELAXED);
+    }
+    if (index_ < capacity) {
+        __atomic_store_n(&indexed[index_], this, __ATOMIC_RELEASE);
     } else {
-        for (index_ = 0; index_ != capacity && indexed[index_]; ++index_) {
+        for (index_ = 0; index_ != capacity; ++index_) {
+            driver* expected = nullptr;
+            if (__atomic_compare_exchange_n(&indexed[index_], &expected, this,
+                                            false, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
         }
     }
     assert(index_ < capacity);
-    indexed[index_] = this;
+
+#if HAVE_SYS_EVENTFD_H
+    post_fd_[0] = post_fd_[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+    if (pipe(post_fd_) == 0) {
+        for (int i = 0; i != 2; ++i) {
+            fcntl(post_fd_[i], F_SETFL, O_NONBLOCK);
+            fcntl(post_fd_[i], F_SETFD, FD_CLOEXEC);
+        }
+    } else {
+        post_fd_[0] = post_fd_[1] = -1;
+    }
+#endif
 }
 
 driver::~driver() {
-    indexed[index_] = nullptr;
+    clear_posted();
+    delete profile_data_;
+    if (post_fd_[0] >= 0) {
+        close(post_fd_[0]);
+    }
+    if (post_fd_[1] != post_fd_[0]) {
+        close(post_fd_[1]);
+    }
+    __atomic_store_n(&indexed[index_], nullptr, __ATOMIC_RELEASE);
+    driver* me = this;
+    __atomic_compare_exchange_n(&sig_driver, &me, nullptr, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
     if (main == this) {
         main = nullptr;
     }
@@ -60,14 +101,117 @@ void driver::blocked_locations(std::vector<std::string>& x) {
 void driver::set_error_handler(error_handler_type) {
 }
 
+struct driver::posted {
+    posted* next;
+    tamerpriv::simple_event* se;
+    int flags;
+};
+
+/** @brief  Trigger @a e on this driver, from any thread.
+ *  @param  e  Event.
+ *
+ *  The trigger is queued in a lock-free mailbox and performed by this
+ *  driver's own thread the next time through its loop, which is woken if
+ *  necessary. @a e must belong to this driver's thread, and the caller
+ *  must hold the only reference to it. Pending posts do not keep the loop
+ *  running; use remote_event for that. */
+void driver::post(event<> e) {
+    if (e) {
+        post(e.__release_simple(), 0);
+    }
+}
+
+void driver::post(tamerpriv::simple_event* se, int flags) {
+    posted* p = new posted{nullptr, se, flags};
+    posted* head = __atomic_load_n(&posted_, __ATOMIC_RELAXED);
+    do {
+        p->next = head;
+    } while (!__atomic_compare_exchange_n(&posted_, &head, p, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    // only the post that makes the mailbox nonempty needs to wake the loop
+    if (!head && post_fd_[1] >= 0) {
+        uint64_t one = 1;
+        ssize_t r = write(post_fd_[1], &one, post_fd_[0] == post_fd_[1] ? 8 : 1);
+        (void) r;
+    }
+}
+
+void driver::run_posted() {
+    uint64_t buf[8];
+    while (post_fd_[0] >= 0 && read(post_fd_[0], buf, sizeof(buf)) > 0) {
+    }
+    // the mailbox is a stack; reverse it to trigger in posting order
+    posted* p = __atomic_exchange_n(&posted_, nullptr, __ATOMIC_ACQUIRE);
+    posted* fifo = nullptr;
+    while (p) {
+        posted* next = p->next;
+        p->next = fifo;
+        fifo = p;
+        p = next;
+    }
+    while ((p = fifo)) {
+        fifo = p->next;
+        if (p->flags & 1) {
+            --nremote_;
+        }
+        if (p->flags & 2) {
+            tamerpriv::simple_event::unuse(p->se);
+        } else {
+            p->se->simple_trigger(false);
+        }
+        delete p;
+    }
+}
+
+void driver::clear_posted() {
+    posted* p = __atomic_exchange_n(&posted_, nullptr, __ATOMIC_ACQUIRE);
+    while (p) {
+        posted* next = p->next;
+        if (p->flags & 1) {
+            --nremote_;
+        }
+        tamerpriv::simple_event::unuse(p->se);
+        delete p;
+        p = next;
+    }
+}
+
+
+/** @class remote_event tamer/driver.hh <tamer/driver.hh>
+ *  @brief  An event<> that can be triggered from any thread.
+ *
+ *  A remote_event is created in the thread that owns an event<>, and may
+ *  then be moved to another thread and triggered there. The trigger is
+ *  posted to the owning driver (see driver::post) and takes effect in the
+ *  owning thread. While a remote_event exists, the owning driver's loop
+ *  keeps running. Destroying a remote_event without triggering it drops
+ *  the underlying event, again in the owning thread. */
+
+/** @brief  Construct a remote_event for @a e.
+ *
+ *  Must be called by the thread that owns @a e; that thread's driver
+ *  becomes the target. */
+remote_event::remote_event(event<> e)
+    : d_(e ? driver::main : nullptr), se_(nullptr) {
+    if (d_) {
+        se_ = e.__release_simple();
+        ++d_->nremote_;
+    }
+}
+
 bool initialize(int flags) {
     if (driver::main) {
         return true;
     }
 
-    if (!(flags & (init_tamer | init_libevent | init_libev | init_strict))) {
+    if (!(flags & (init_tamer | init_libevent | init_libev | init_uring
+                   | init_strict))) {
         const char* dname = getenv("TAMER_DRIVER");
-        if (dname && strcmp(dname, "libev") == 0) {
+        if (dname && strcmp(dname, "uring") == 0) {
+            flags |= init_uring;
+        } else if (dname && strcmp(dname, "epoll_et") == 0) {
+            flags |= init_tamer | init_epoll_et;
+        } else if (dname && strcmp(dname, "libev") == 0) {
             flags |= init_libev;
         } else if (dname && strcmp(dname, "libevent") == 0) {
             flags |= init_libevent;
@@ -76,6 +220,16 @@ bool initialize(int flags) {
         }
     }
 
+    if (!(flags & init_timer_wheel)) {
+        const char* tname = getenv("TAMER_TIMERS");
+        if (tname && strcmp(tname, "wheel") == 0) {
+            flags |= init_timer_wheel;
+        }
+    }
+
+    if (!driver::main && (flags & init_uring)) {
+        driver::main = driver::make_uring(flags);
+    }
     if (!driver::main && (flags & init_libev)) {
         driver::main = driver::make_libev();
     }
@@ -106,51 +260,364 @@ void cleanup() {
 void set_time_type(time_type_t tt) {
     if (tamerpriv::time_type != tt) {
         if (tamerpriv::time_type == time_virtual) {
-            tamerpriv::virtual_offset = tamerpriv::recent;
+            tamerpriv::virtual_offset = tamerpriv::recent_nsec;
         }
         tamerpriv::time_type = tt;
         tamerpriv::need_recent = true;
         if (tamerpriv::time_type == time_virtual) {
-            tamerpriv::recent = tamerpriv::virtual_offset;
+            tamerpriv::set_recent_nsec(tamerpriv::virtual_offset);
         }
     }
 }
 
-timeval now() {
+static uint64_t monotonic_nsec() {
+#if HAVE_CLOCK_GETTIME
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    timeval tv;
+    gettimeofday(&tv, 0);
+    return tamerpriv::timeval_nsec(tv);
+#endif
+}
+
+// Tamer time is the monotonic clock shifted to match the wall clock at
+// the first call.
+static uint64_t monotonic_offset(uint64_t mono) {
+    static const uint64_t offset = [mono] {
+        timeval tv;
+        gettimeofday(&tv, 0);
+        return tamerpriv::timeval_nsec(tv) - mono;
+    }();
+    return offset;
+}
+
+uint64_t now_nsec() {
     if (tamerpriv::time_type == time_normal) {
-        gettimeofday(&tamerpriv::recent, 0);
+        uint64_t mono = monotonic_nsec();
+        tamerpriv::set_recent_nsec(mono + monotonic_offset(mono));
     } else {
-        ++tamerpriv::recent.tv_usec;
-        if (tamerpriv::recent.tv_usec == 1000000) {
-            ++tamerpriv::recent.tv_sec;
-            tamerpriv::recent.tv_usec = 0;
-        }
+        tamerpriv::set_recent_nsec(tamerpriv::recent_nsec + 1000);
     }
     tamerpriv::need_recent = false;
+    return tamerpriv::recent_nsec;
+}
+
+timeval now() {
+    now_nsec();
     return tamerpriv::recent;
 }
 
+static timeval delay_timeval(double delay) {
+    timeval tv;
+    tv.tv_sec = (long) delay;
+    tv.tv_usec = (long) ((delay - tv.tv_sec) * 1000000 + 0.5);
+    if (tv.tv_usec >= 1000000) {
+        tv.tv_sec++;
+        tv.tv_usec -= 1000000;
+    }
+    return tv;
+}
+
+void driver::at_time(const timeval& expiry, event<> e, bool bg) {
+    at_time(expiry, e, bg, timer_slack_);
+}
+
+void driver::at_time(const timeval& expiry, event<> e, bool bg,
+                     const timeval&) {
+    at_time(expiry, e, bg);
+}
+
 void driver::at_delay(double delay, event<> e, bool bg) {
     if (delay <= 0) {
         at_asap(e);
     } else {
-        timeval tv = recent();
-        long ldelay = (long) delay;
-        tv.tv_sec += ldelay;
-        tv.tv_usec += (long) ((delay - ldelay) * 1000000 + 0.5);
-        if (tv.tv_usec >= 1000000) {
-            tv.tv_sec++;
-            tv.tv_usec -= 1000000;
-        }
+        timeval tv = delay_timeval(delay);
+        timeradd(&tv, &recent(), &tv);
         at_time(tv, e, bg);
     }
 }
 
+void driver::at_delay(double delay, event<> e, bool bg, double slack) {
+    if (delay <= 0) {
+        at_asap(e);
+    } else {
+        timeval tv = delay_timeval(delay);
+        timeradd(&tv, &recent(), &tv);
+        at_time(tv, e, bg, delay_timeval(slack > 0 ? slack : 0));
+    }
+}
+
+void driver::set_timer_slack(double slack) {
+    timer_slack_ = delay_timeval(slack > 0 ? slack : 0);
+}
+
+bool driver::has_fd_io() const {
+    return false;
+}
+
+bool driver::at_fd_io(int, const fd_io&, event<int>) {
+    return false;
+}
+
+bool driver::has_fd_errqueue() const {
+    return false;
+}
+
 timeval driver::next_wake() const {
     timeval unknown = { 0, 0 };
     return unknown;
 }
 
+/** @brief  Return counters describing this driver's work so far.
+ *
+ *  Counters are kept as the loop runs and are cheap to maintain; queue
+ *  depths and the blocked closure count are measured on each call. Not
+ *  every driver fills in every counter. */
+driver_stats driver::stats() const {
+    driver_stats s = stats_;
+    for (unsigned i = 0; i != this->nclosure_slots(); ++i) {
+        s.closures_blocked += this->closure_slot(i) != nullptr;
+    }
+    s.events_live = tamerpriv::simple_event_pool::nlive_;
+    s.events_peak = tamerpriv::simple_event_pool::npeak_;
+    return s;
+}
+
+/** @brief  Call @a h with this driver's statistics every @a period seconds.
+ *  @param  h       Handler, or null to stop.
+ *  @param  period  Period in seconds.
+ *
+ *  The handler runs from a background timer, so it does not keep the loop
+ *  running. */
+void driver::set_stats_handler(stats_handler_type h, double period) {
+    stats_handler_ = h;
+    stats_period_ = period;
+    ++stats_gen_;
+    if (h && period > 0) {
+        at_delay(period, fun_event(stats_tick, this, stats_gen_), true);
+    }
+}
+
+void driver::stats_tick(driver* d, unsigned gen) {
+    if (gen == d->stats_gen_ && d->stats_handler_) {
+        d->stats_handler_(d, d->stats());
+        if (gen == d->stats_gen_) {
+            d->at_delay(d->stats_period_, fun_event(stats_tick, d, gen), true);
+        }
+    }
+}
+
+// Drivers call these around each wait for events.
+void driver::stats_before_wait() {
+    uint64_t t = monotonic_nsec();
+    if (stats_clock_) {
+        uint64_t running = t - stats_clock_;
+        stats_.running_nsec += running;
+        loop_latency_.add(running);
+        if (stall_nsec_ && running >= stall_nsec_) {
+            report_stall(running);
+        }
+    }
+    stats_clock_ = t;
+}
+
+void driver::stats_after_wait() {
+    uint64_t t = monotonic_nsec();
+    stats_.blocked_nsec += t - stats_clock_;
+    stats_clock_ = t;
+    ++stats_.loops;
+    if (stall_nsec_) {
+        profile_data_->ran.clear();
+    }
+}
+
+void tamerpriv::simple_driver::run_unblocked_profiled() {
+    while (closure* c = pop_unblocked()) {
+        if (!profile_) {
+            c->tamer_activator_(c);
+            continue;
+        }
+        // c may be freed by its activation
+        closure_profile::key k = {c->tamer_activator_, c->location_file(),
+                                  c->location_line()};
+        closure_profile* p = profile_;
+        uint64_t t0 = monotonic_nsec();
+        c->tamer_activator_(c);
+        uint64_t t = monotonic_nsec() - t0;
+        if (p->aggregate) {
+            auto& s = p->m[k];
+            ++s.count;
+            s.nsec += t;
+            s.max_nsec = std::max(s.max_nsec, t);
+        }
+        if (p->trace) {
+            p->ran.emplace_back(k, t);
+        }
+    }
+}
+
+tamerpriv::closure_profile* driver::make_profile() {
+    if (!profile_data_) {
+        profile_data_ = new tamerpriv::closure_profile;
+    }
+    return profile_data_;
+}
+
+static std::string profile_location(const tamerpriv::closure_profile::key& k) {
+    char buf[128];
+    if (k.file) {
+        snprintf(buf, sizeof(buf), "%s:%d", k.file, k.line);
+    } else {
+        snprintf(buf, sizeof(buf), "closure %p", reinterpret_cast<void*>(k.f));
+    }
+    return buf;
+}
+
+static bool profile_entry_compare(const closure_profile_entry& a,
+                                  const closure_profile_entry& b) {
+    return a.nsec > b.nsec || (a.nsec == b.nsec && a.location < b.location);
+}
+
+/** @brief  Turn closure profiling on or off.
+ *
+ *  While profiling is on, the driver times each closure activation and
+ *  aggregates the times by the location of the twait the closure resumed
+ *  from. Turning profiling off keeps the data collected so far.
+ *
+ *  @sa closure_profile, print_closure_profile */
+void driver::set_closure_profiling(bool on) {
+    tamerpriv::closure_profile* p = make_profile();
+    p->aggregate = on;
+    profile_ = p->aggregate || p->trace ? p : nullptr;
+}
+
+/** @brief  Append the closure profile to @a x, most expensive first. */
+void driver::closure_profile(std::vector<closure_profile_entry>& x) const {
+    if (!profile_data_) {
+        return;
+    }
+    size_t first = x.size();
+    for (auto& it : profile_data_->m) {
+        closure_profile_entry e;
+        e.location = profile_location(it.first);
+        e.count = it.second.count;
+        e.nsec = it.second.nsec;
+        e.max_nsec = it.second.max_nsec;
+        x.push_back(std::move(e));
+    }
+    std::sort(x.begin() + first, x.end(), profile_entry_compare);
+}
+
+/** @brief  Print the closure profile to @a f.
+ *  @param  folded  If true, print in folded-stack format, one
+ *                  &ldquo;location microseconds&rdquo; line per location,
+ *                  suitable for flame graph tools.
+ *
+ *  The default format is a table sorted by total time. */
+void driver::print_closure_profile(FILE* f, bool folded) const {
+    std::vector<closure_profile_entry> x;
+    closure_profile(x);
+    if (!folded) {
+        fprintf(f, "%12s %10s %10s %10s  %s\n",
+                "total_us", "count", "avg_us", "max_us", "location");
+    }
+    for (auto& e : x) {
+        if (folded) {
+            fprintf(f, "tamer;%s %llu\n", e.location.c_str(),
+                    (unsigned long long) (e.nsec / 1000));
+        } else {
+            fprintf(f, "%12.1f %10llu %10.2f %10.1f  %s\n",
+                    e.nsec / 1000., (unsigned long long) e.count,
+                    e.nsec / 1000. / e.count, e.max_nsec / 1000.,
+                    e.location.c_str());
+        }
+    }
+}
+
+/** @brief  Discard the closure profile collected so far. */
+void driver::clear_closure_profile() {
+    if (profile_data_) {
+        profile_data_->m.clear();
+    }
+}
+
+void latency_histogram::clear() {
+    count_ = max_ = 0;
+    std::fill(b_, b_ + nbuckets, 0);
+}
+
+/** @brief  Return an upper bound on the @a p quantile, 0 <= @a p <= 1. */
+uint64_t latency_histogram::percentile(double p) const {
+    uint64_t want = uint64_t(p * count_ + 0.999999);
+    want = std::max(want, uint64_t(1));
+    uint64_t seen = 0;
+    for (unsigned b = 0; b != nbuckets; ++b) {
+        seen += b_[b];
+        if (seen >= want) {
+            return b + 1 < nbuckets ? std::min(bucket_low(b + 1) - 1, max_)
+                : max_;
+        }
+    }
+    return max_;
+}
+
+/** @brief  Return the histogram of loop iteration running times.
+ *
+ *  Each sample is the time from the end of one wait for events to the
+ *  start of the next: the time spent running closures, timers, and
+ *  callbacks while no I/O is noticed. */
+const latency_histogram& driver::loop_latency() const {
+    return loop_latency_;
+}
+
+/** @brief  Report loop iterations that run longer than @a threshold.
+ *  @param  threshold  Threshold in seconds; 0 turns the detector off.
+ *  @param  h          Handler, or null to print reports to stderr.
+ *
+ *  When an iteration exceeds the threshold, the handler receives the
+ *  iteration's running time and the closure locations that ran during
+ *  it, most expensive first. A long iteration with no expensive closures
+ *  points at a timer or callback. */
+void driver::set_stall_threshold(double threshold, stall_handler_type h) {
+    stall_nsec_ = threshold > 0 ? uint64_t(threshold * 1e9) : 0;
+    stall_handler_ = h;
+    tamerpriv::closure_profile* p = make_profile();
+    p->trace = stall_nsec_ != 0;
+    p->ran.clear();
+    profile_ = p->aggregate || p->trace ? p : nullptr;
+}
+
+void driver::report_stall(uint64_t nsec) {
+    std::unordered_map<tamerpriv::closure_profile::key,
+                       tamerpriv::closure_profile::stat,
+                       tamerpriv::closure_profile::key_hash> m;
+    for (auto& r : profile_data_->ran) {
+        auto& s = m[r.first];
+        ++s.count;
+        s.nsec += r.second;
+        s.max_nsec = std::max(s.max_nsec, r.second);
+    }
+    std::vector<closure_profile_entry> x;
+    for (auto& it : m) {
+        x.push_back(closure_profile_entry{profile_location(it.first),
+                                          it.second.count, it.second.nsec,
+                                          it.second.max_nsec});
+    }
+    std::sort(x.begin(), x.end(), profile_entry_compare);
+    if (stall_handler_) {
+        stall_handler_(this, nsec, x);
+        return;
+    }
+    fprintf(stderr, "tamer: loop iteration ran %.3f ms\n", nsec / 1e6);
+    for (auto& e : x) {
+        fprintf(stderr, "  %s: %.3f ms in %llu activations\n",
+                e.location.c_str(), e.nsec / 1e6,
+                (unsigned long long) e.count);
+    }
+}
+
 void driver::clear() {
     while (has_unblocked()) {
         run_unblocked();
@@ -182,6 +649,9 @@ void driver_asapset::expand() {
 }
 
 void driver_timerset::clear() {
+    if (wheel_) {
+        wheel_->clear();
+    }
     for (unsigned i = 0; i != nts_; ++i) {
         simple_event::unuse(ts_[i].se);
     }
@@ -204,7 +674,7 @@ void driver_timerset::check() {
                     location = "@" + br->blocked_closure_->location_description();
             }
         }
-        fprintf(stderr, " %3u: %ld.%06ld%s: %s\n", k, ts_[k].when.tv_sec, ts_[k].when.tv_usec,
+        fprintf(stderr, " %3u: %llu%s: %s\n", k, (unsigned long long) ts_[k].when,
                 ts_[k].order & 1 ? "" : "-", location.c_str());
     }
     fprintf(stderr, "\n");
@@ -219,7 +689,7 @@ void driver_timerset::check() {
             if (ts_[trial] < ts_[i]) {
                 fprintf(stderr, "***");
                 for (unsigned k = 0; k != nts_; ++k)
-                    fprintf(stderr, (k == i || k == trial ? " **%ld.%06ld**" : " %ld.%06ld"), ts_[k].when.tv_sec, ts_[k].when.tv_usec);
+                    fprintf(stderr, (k == i || k == trial ? " **%llu**" : " %llu"), (unsigned long long) ts_[k].when);
                 fprintf(stderr, "\n");
                 assert(0);
             }
@@ -238,10 +708,25 @@ void driver_timerset::expand() {
     tcap_ = ncap;
 }
 
-void driver_timerset::push(timeval when, simple_event* se, bool bg) {
+void driver_timerset::use_wheel() {
+    assert(nts_ == 0);
+    if (!wheel_) {
+        wheel_ = new driver_timerwheel;
+    }
+}
+
+void driver_timerset::push(uint64_t when, simple_event* se, bool bg,
+                           uint64_t slack) {
     using std::swap;
     assert(!se->empty());
 
+    // Key on the latest firing time; remember how much earlier is allowed
+    unsigned uslack = std::min(slack, uint64_t(4000000000000)) / 1000;
+    when += uint64_t(uslack) * 1000;
+    if (wheel_) {
+        return wheel_->push(when, se, bg, uslack);
+    }
+
     // Append new trec
     if (nts_ == tcap_) {
         expand();
@@ -250,8 +735,10 @@ void driver_timerset::push(timeval when, simple_event* se, bool bg) {
     ts_[pos].when = when;
     order_ += 2;
     ts_[pos].order = order_ + !bg;
+    ts_[pos].slack = uslack;
     ts_[pos].se = se;
     ++nts_;
+    ++npushed_;
     nfg_ += !bg;
 
     // Swap trec to proper position in heap
@@ -284,8 +771,14 @@ void driver_timerset::hard_cull(unsigned pos) const {
 
     if (pos == (unsigned) -1) {
         pos = 0;
+        if (ts_[pos].se->empty()) {
+            ++nculled_;
+        } else {
+            ++nfired_;
+        }
         ts_[pos].se->simple_trigger(false);
     } else {
+        ++nculled_;
         ts_[pos].clean();
     }
 
@@ -319,5 +812,370 @@ void driver_timerset::hard_cull(unsigned pos) const {
     }
 }
 
+driver_timerwheel::driver_timerwheel() {
+    memset(slots_, 0, sizeof(slots_));
+    memset(bits_, 0, sizeof(bits_));
+}
+
+driver_timerwheel::~driver_timerwheel() {
+    clear();
+    while (wrec* w = free_) {
+        free_ = w->next;
+        delete w;
+    }
+}
+
+inline bool driver_timerwheel::wrec::operator<(const wrec& x) const {
+    return when < x.when
+        || (when == x.when && (int) (order - x.order) < 0);
+}
+
+inline uint64_t driver_timerwheel::tick(uint64_t ns) {
+    return ns / 1000000;
+}
+
+// Return the distance from slot @a start to the first nonempty slot at
+// @a level, wrapping around, or -1 if the level is empty.
+inline int driver_timerwheel::find_slot(int level, unsigned start) const {
+    enum { nwords = nslots / 64 };
+    const uint64_t* bits = &bits_[level * nwords];
+    unsigned w0 = start / 64, b0 = start % 64;
+    for (unsigned i = 0; i <= nwords; ++i) {
+        unsigned wi = (w0 + i) % nwords;
+        uint64_t m = bits[wi];
+        if (i == 0) {
+            m &= ~uint64_t(0) << b0;
+        } else if (i == nwords) {
+            m &= (uint64_t(1) << b0) - 1;
+        }
+        if (m) {
+            return (wi * 64 + __builtin_ctzll(m) - start) & slotmask;
+        }
+    }
+    return -1;
+}
+
+// Level-0 timers lie in ticks now_ through now_ + 255. Timers at a higher
+// level lie in the 256 blocks of that level's size following now_'s
+// block; return the first tick of the block @a distance past the first of
+// these, where @a distance was found by find_slot.
+inline uint64_t driver_timerwheel::slot_start(int level, int distance) const {
+    unsigned shift = slotbits * level;
+    return ((now_ >> shift) + distance + 1) << shift;
+}
+
+void driver_timerwheel::find_expiry() const {
+    wrec* best = slots_[ready_slot];
+    int k = find_slot(0, now_ & slotmask);
+    if (k >= 0) {
+        for (wrec* w = slots_[(now_ + k) & slotmask]; w; w = w->next) {
+            if (!best || *w < *best) {
+                best = w;
+            }
+        }
+    }
+    uint64_t t = best ? tick(best->when) : ~uint64_t(0);
+    for (int level = 1; level != nlevels; ++level) {
+        unsigned shift = slotbits * level;
+        int kl = find_slot(level, ((now_ >> shift) + 1) & slotmask);
+        if (kl >= 0 && slot_start(level, kl) <= t) {
+            best = nullptr;
+            t = slot_start(level, kl);
+        }
+    }
+    first_ = best;
+    expiry_ = best ? best->when : t * 1000000;
+    expiry_ok_ = true;
+}
+
+void driver_timerwheel::insert(wrec* w) {
+    uint64_t t = tick(w->when);
+    unsigned s;
+    if (t <= now_ && slots_[ready_slot]) {
+        // keep the due list sorted
+        wrec** pprev = &slots_[ready_slot];
+        while (*pprev && !(*w < **pprev)) {
+            pprev = &(*pprev)->next;
+        }
+        w->slot = ready_slot;
+        w->pprev = pprev;
+        w->next = *pprev;
+        if (w->next) {
+            w->next->pprev = &w->next;
+        }
+        *pprev = w;
+        return;
+    } else if (t <= now_) {
+        s = now_ & slotmask;
+    } else {
+        int level = 0;
+        while (level != nlevels - 1
+               && t - now_ >= uint64_t(1) << (slotbits * (level + 1))) {
+            ++level;
+        }
+        unsigned shift = slotbits * level;
+        if (level == nlevels - 1
+            && (t >> shift) - (now_ >> shift) > nslots) {
+            // beyond the wheel: park in the last slot, revisit on cascade
+            t = now_;
+        }
+        s = level * nslots + ((t >> shift) & slotmask);
+    }
+    w->slot = s;
+    w->pprev = &slots_[s];
+    w->next = slots_[s];
+    if (w->next) {
+        w->next->pprev = &w->next;
+    }
+    slots_[s] = w;
+    bits_[s / 64] |= uint64_t(1) << (s % 64);
+}
+
+inline void driver_timerwheel::forget(wrec* w) {
+    --nts_;
+    nfg_ -= w->order & 1;
+    if (first_ == w) {
+        expiry_ok_ = false;
+    }
+}
+
+// Free an unhooked timer whose event was triggered elsewhere.
+inline void driver_timerwheel::release(wrec* w) {
+    ++nculled_;
+    simple_event::unuse_clean(w->se);
+    w->next = free_;
+    free_ = w;
+}
+
+void driver_timerwheel::unlink(wrec* w) {
+    *w->pprev = w->next;
+    if (w->next) {
+        w->next->pprev = w->pprev;
+    }
+    if (w->slot != ready_slot && !slots_[w->slot]) {
+        bits_[w->slot / 64] &= ~(uint64_t(1) << (w->slot % 64));
+    }
+    forget(w);
+}
+
+void driver_timerwheel::cascade(int level, unsigned idx) {
+    unsigned s = level * nslots + idx;
+    wrec* w = slots_[s];
+    slots_[s] = nullptr;
+    bits_[s / 64] &= ~(uint64_t(1) << (s % 64));
+    while (w) {
+        wrec* next = w->next;
+        if (!w->hooked && w->se->empty()) {
+            forget(w);
+            release(w);
+        } else {
+            insert(w);
+        }
+        w = next;
+    }
+    expiry_ok_ = false;
+}
+
+// Move the wheel's clock forward to tick @a t, cascading timers from the
+// upper levels as their blocks come due. Stops early at a pending level-0
+// timer.
+void driver_timerwheel::advance(uint64_t t) {
+    if (nts_ == 0) {
+        now_ = t > now_ ? t : now_;
+        return;
+    }
+    while (now_ < t) {
+        int k = find_slot(0, now_ & slotmask);
+        if (k == 0) {
+            break;
+        }
+        uint64_t b;
+        if (k > 0) {
+            b = (now_ | slotmask) + 1;
+            if (now_ + k < b || t < b) {
+                now_ = std::min(now_ + k, t);
+                break;
+            }
+        } else {
+            b = ~uint64_t(0);
+            for (int level = 1; level != nlevels; ++level) {
+                int kl = find_slot(level, ((now_ >> (slotbits * level)) + 1)
+                                   & slotmask);
+                if (kl >= 0) {
+                    b = std::min(b, slot_start(level, kl));
+                }
+            }
+            if (t < b) {
+                now_ = t;
+                break;
+            }
+        }
+        now_ = b;
+        for (int level = nlevels - 1; level != 0; --level) {
+            unsigned shift = slotbits * level;
+            if ((b & ((uint64_t(1) << shift) - 1)) == 0) {
+                cascade(level, (b >> shift) & slotmask);
+            }
+        }
+    }
+}
+
+// Sort the timers in now_'s slot onto the due list.
+void driver_timerwheel::make_ready() {
+    unsigned s = now_ & slotmask;
+    for (wrec* w = slots_[s]; w; w = w->next) {
+        batch_.push_back(w);
+    }
+    for (wrec* w = slots_[ready_slot]; w; w = w->next) {
+        batch_.push_back(w);
+    }
+    slots_[s] = nullptr;
+    bits_[s / 64] &= ~(uint64_t(1) << (s % 64));
+    std::sort(batch_.begin(), batch_.end(),
+              [](wrec* a, wrec* b) { return *a < *b; });
+    wrec** pprev = &slots_[ready_slot];
+    for (wrec* w : batch_) {
+        w->slot = ready_slot;
+        w->pprev = pprev;
+        *pprev = w;
+        pprev = &w->next;
+    }
+    *pprev = nullptr;
+    batch_.clear();
+    expiry_ok_ = false;
+}
+
+void driver_timerwheel::reap() {
+    while (wrec* w = dead_) {
+        dead_ = w->next;
+        simple_event::unuse(w->se);
+        w->next = free_;
+        free_ = w;
+    }
+}
+
+void driver_timerwheel::cull() {
+    reap();
+    advance(tick(tamer::recent_nsec()));
+    while (wrec* w = slots_[ready_slot]) {
+        if (w->hooked || !w->se->empty()) {
+            break;
+        }
+        unlink(w);
+        release(w);
+    }
+}
+
+void driver_timerwheel::push(uint64_t when, simple_event* se, bool bg,
+                             unsigned slack) {
+    assert(!se->empty());
+    if (nts_ == 0) {
+        advance(tick(tamer::recent_nsec()));
+    }
+    wrec* w = free_;
+    if (w) {
+        free_ = w->next;
+    } else {
+        w = new wrec;
+    }
+    w->when = when;
+    order_ += 2;
+    w->order = order_ + !bg;
+    w->slack = slack;
+    w->se = se;
+    w->owner = this;
+    w->hooked = !se->has_at_trigger();
+    insert(w);
+    ++nts_;
+    ++npushed_;
+    nfg_ += !bg;
+    if (expiry_ok_ && when < expiry_) {
+        expiry_ = when;
+        first_ = w;
+    }
+    if (w->hooked) {
+        simple_event::at_trigger(se, hook, w);
+    }
+}
+
+void driver_timerwheel::pop_trigger() {
+    uint64_t now = tamer::recent_nsec();
+    expiry();
+    if (!first_) {
+        advance(tick(now));
+        if (find_slot(0, now_ & slotmask) == 0) {
+            make_ready();
+        }
+        if (nts_ == 0 || (expiry(), !first_)) {
+            return;
+        }
+    }
+    wrec* w = first_;
+    if (!timer_window_open(w->when, w->slack, now)) {
+        return;
+    }
+    if (w->slot != ready_slot) {
+        // w's window is open before its tick; move the clock to that tick
+        advance(tick(w->when));
+        make_ready();
+    }
+    assert(slots_[ready_slot] == w);
+    unlink(w);
+    simple_event* se = w->se;
+    if (se->empty()) {
+        ++nculled_;
+    } else {
+        ++nfired_;
+    }
+    w->se = nullptr;
+    if (!w->hooked) {
+        w->next = free_;
+        free_ = w;
+    }
+    se->simple_trigger(false);  // if hooked, calls hook(w), which frees w
+}
+
+// Called when a timer's event is triggered, by the wheel or by anyone
+// else, or when its rendezvous goes away. The wheel's reference to the
+// event is dropped later, in reap(), since the event may still be in use.
+void driver_timerwheel::hook(void* arg) {
+    wrec* w = static_cast<wrec*>(arg);
+    driver_timerwheel* tw = w->owner;
+    if (!tw) {
+        delete w;
+    } else if (!w->se) {
+        w->next = tw->free_;
+        tw->free_ = w;
+    } else {
+        tw->unlink(w);
+        ++tw->nculled_;
+        w->next = tw->dead_;
+        tw->dead_ = w;
+    }
+}
+
+void driver_timerwheel::clear() {
+    reap();
+    for (unsigned s = 0; s != nlevels * nslots + 1; ++s) {
+        wrec* w = slots_[s];
+        slots_[s] = nullptr;
+        while (w) {
+            wrec* next = w->next;
+            simple_event* se = w->se;
+            if (w->hooked) {
+                w->owner = nullptr;
+                w->se = nullptr;
+            } else {
+                delete w;
+            }
+            simple_event::unuse(se);
+            w = next;
+        }
+    }
+    memset(bits_, 0, sizeof(bits_));
+    nts_ = nfg_ = 0;
+    expiry_ok_ = false;
+}
+
 } // namespace tamerpriv
 } // namespace tamer
@@ -4,12 +4,14 @@
 #include <tamer/driver.hh>
 #include <sys/types.h>
 #include <string.h>
+#include <unordered_map>
+#include <vector>
 namespace tamer {
 namespace tamerpriv {
 
 template <typename T>
 struct driver_fd : public T {
-    event<int> e[3];
+    event<int> e[nfdactions];
     int next_changedfd1;
 
     template <typename O> inline driver_fd(O owner, int fd);
@@ -52,6 +54,7 @@ struct driver_asapset {
     inline ~driver_asapset();
 
     inline bool empty() const;
+    inline unsigned size() const;
     inline void push(simple_event* se);
     inline void pop_trigger();
     void clear();
@@ -65,23 +68,101 @@ struct driver_asapset {
     void expand();
 };
 
+// Hierarchical timing wheel with millisecond ticks. Insertion is O(1). A
+// timer whose event is triggered elsewhere leaves the wheel at once,
+// through an at_trigger hook on that event; if the event already has a
+// hook, the timer is instead culled lazily, as in the heap. Timers more
+// than 256 ticks out are kept in coarser slots, for which expiry()
+// reports the start of the slot; they move to exact slots as time passes.
+class driver_timerwheel {
+  public:
+    driver_timerwheel();
+    ~driver_timerwheel();
+
+    inline bool empty() const;
+    inline bool has_foreground() const;
+    inline uint64_t expiry() const;
+    inline unsigned expiry_slack() const;
+    void cull();
+    void push(uint64_t when, simple_event* se, bool bg, unsigned slack);
+    void pop_trigger();
+    void clear();
+    inline void stats(driver_stats& s) const;
+
+  private:
+    struct wrec {
+        wrec* next;
+        wrec** pprev;
+        uint64_t when;
+        unsigned order;
+        unsigned slot;
+        unsigned slack;
+        simple_event* se;
+        driver_timerwheel* owner;
+        bool hooked;
+        inline bool operator<(const wrec& x) const;
+    };
+
+    enum { nlevels = 4, slotbits = 8, nslots = 1 << slotbits,
+           slotmask = nslots - 1, ready_slot = nlevels * nslots };
+    wrec* slots_[nlevels * nslots + 1];   // last: due timers, sorted
+    uint64_t bits_[nlevels * nslots / 64];
+    uint64_t now_ = 0;
+    unsigned nts_ = 0;
+    unsigned nfg_ = 0;
+    unsigned order_ = 0;
+    mutable uint64_t expiry_;
+    mutable wrec* first_ = nullptr;
+    mutable bool expiry_ok_ = false;
+    wrec* dead_ = nullptr;
+    wrec* free_ = nullptr;
+    std::vector<wrec*> batch_;
+    uint64_t npushed_ = 0;
+    uint64_t nfired_ = 0;
+    uint64_t nculled_ = 0;
+
+    static inline uint64_t tick(uint64_t ns);
+    inline int find_slot(int level, unsigned start) const;
+    inline uint64_t slot_start(int level, int distance) const;
+    void find_expiry() const;
+    void insert(wrec* w);
+    void unlink(wrec* w);
+    inline void forget(wrec* w);
+    inline void release(wrec* w);
+    void cascade(int level, unsigned idx);
+    void advance(uint64_t t);
+    void make_ready();
+    void reap();
+    static void hook(void* arg);
+};
+
+// Timers are kept in order of their latest firing times, which expiry()
+// reports in nanoseconds. A timer with slack may fire up to that much
+// before its latest time; due() is true while the first timer's window
+// has opened, so timers with overlapping windows fire on the same wakeup.
+// Slack is kept in microseconds.
 struct driver_timerset {
     inline ~driver_timerset();
 
     inline bool empty() const;
     inline bool has_foreground() const;
-    inline const timeval& expiry() const;
+    inline uint64_t expiry() const;
+    inline unsigned expiry_slack() const;
+    inline bool due(uint64_t now) const;
     inline void cull();
-    void push(timeval when, simple_event* se, bool bg);
+    void push(uint64_t when, simple_event* se, bool bg, uint64_t slack);
     inline void pop_trigger();
     void clear();
+    void use_wheel();
+    inline void stats(driver_stats& s) const;
 
     void check();
 
   private:
     struct trec {
-        timeval when;
+        uint64_t when;
         unsigned order;
+        unsigned slack;
         simple_event* se;
         inline bool operator<(const trec &x) const;
         inline void clean();
@@ -94,6 +175,10 @@ struct driver_timerset {
     unsigned rand_ = 8173;
     unsigned tcap_ = 0;
     unsigned order_ = 0;
+    uint64_t npushed_ = 0;
+    mutable uint64_t nfired_ = 0;
+    mutable uint64_t nculled_ = 0;
+    driver_timerwheel* wheel_ = nullptr;
 
     static inline unsigned heap_parent(unsigned i);
     static inline unsigned heap_first_child(unsigned i);
@@ -110,7 +195,7 @@ inline driver_fd<T>::driver_fd(O owner, int fd)
 
 template <typename T>
 inline bool driver_fd<T>::empty() const {
-    return e[0].empty() && e[1].empty() && e[2].empty();
+    return e[0].empty() && e[1].empty() && e[2].empty() && e[3].empty();
 }
 
 template <typename T>
@@ -118,6 +203,7 @@ inline void driver_fd<T>::clear() {
     e[0].trigger(outcome::destroy);
     e[1].trigger(outcome::destroy);
     e[2].trigger(outcome::destroy);
+    e[3].trigger(outcome::destroy);
 }
 
 template <typename T>
@@ -245,6 +331,10 @@ inline bool driver_asapset::empty() const {
     return head_ == tail_;
 }
 
+inline unsigned driver_asapset::size() const {
+    return tail_ - head_;
+}
+
 inline void driver_asapset::push(simple_event *se) {
     if (tail_ - head_ == capmask_ + 1) {
         expand();
@@ -260,36 +350,93 @@ inline void driver_asapset::pop_trigger() {
     se->simple_trigger(false);
 }
 
+inline bool driver_timerwheel::empty() const {
+    return nts_ == 0;
+}
+
+inline bool driver_timerwheel::has_foreground() const {
+    return nfg_ != 0;
+}
+
+inline uint64_t driver_timerwheel::expiry() const {
+    assert(nts_ != 0);
+    if (!expiry_ok_) {
+        find_expiry();
+    }
+    return expiry_;
+}
+
+inline void driver_timerwheel::stats(driver_stats& s) const {
+    s.timers_pushed += npushed_;
+    s.timers_fired += nfired_;
+    s.timers_culled += nculled_;
+}
+
+inline unsigned driver_timerwheel::expiry_slack() const {
+    expiry();
+    return first_ ? first_->slack : 0;
+}
+
+// Return true iff @a when less @a slack microseconds is no later than @a now.
+inline bool timer_window_open(uint64_t when, unsigned slack, uint64_t now) {
+    return when <= now + uint64_t(slack) * 1000;
+}
+
 inline driver_timerset::~driver_timerset() {
     clear();
     delete[] ts_;
+    delete wheel_;
 }
 
 inline bool driver_timerset::empty() const {
-    return nts_ == 0;
+    return wheel_ ? wheel_->empty() : nts_ == 0;
 }
 
 inline bool driver_timerset::has_foreground() const {
-    return nfg_ != 0;
+    return wheel_ ? wheel_->has_foreground() : nfg_ != 0;
 }
 
-inline const timeval &driver_timerset::expiry() const {
+inline uint64_t driver_timerset::expiry() const {
+    if (wheel_) {
+        return wheel_->expiry();
+    }
     assert(nts_ != 0);
     return ts_[0].when;
 }
 
+inline unsigned driver_timerset::expiry_slack() const {
+    if (wheel_) {
+        return wheel_->expiry_slack();
+    }
+    assert(nts_ != 0);
+    return ts_[0].slack;
+}
+
+inline void driver_timerset::stats(driver_stats& s) const {
+    if (wheel_) {
+        return wheel_->stats(s);
+    }
+    s.timers_pushed += npushed_;
+    s.timers_fired += nfired_;
+    s.timers_culled += nculled_;
+}
+
+inline bool driver_timerset::due(uint64_t now) const {
+    return !empty() && timer_window_open(expiry(), expiry_slack(), now);
+}
+
 inline void driver_timerset::cull() {
+    if (wheel_) {
+        return wheel_->cull();
+    }
     while (nts_ != 0 && ts_[0].se->empty()) {
         hard_cull(0);
     }
 }
 
 inline bool driver_timerset::trec::operator<(const trec &x) const {
-    return when.tv_sec < x.when.tv_sec
-        || (when.tv_sec == x.when.tv_sec
-            && (when.tv_usec < x.when.tv_usec
-                || (when.tv_usec == x.when.tv_usec
-                    && (int) (order - x.order) < 0)));
+    return when < x.when
+        || (when == x.when && (int) (order - x.order) < 0);
 }
 
 inline void driver_timerset::trec::clean() {
@@ -310,9 +457,40 @@ inline unsigned driver_timerset::heap_last_child(unsigned i) const {
 }
 
 inline void driver_timerset::pop_trigger() {
+    if (wheel_) {
+        return wheel_->pop_trigger();
+    }
     hard_cull((unsigned) -1);
 }
 
+// Closure run times, aggregated by activator and twait location, and
+// (for the stall detector) listed for the current loop iteration.
+struct closure_profile {
+    struct key {
+        closure_activator f;
+        const char* file;
+        int line;
+        inline bool operator==(const key& x) const {
+            return f == x.f && file == x.file && line == x.line;
+        }
+    };
+    struct key_hash {
+        inline size_t operator()(const key& k) const {
+            return (reinterpret_cast<uintptr_t>(k.f) >> 4)
+                ^ (reinterpret_cast<uintptr_t>(k.file) >> 3) ^ k.line;
+        }
+    };
+    struct stat {
+        uint64_t count = 0;
+        uint64_t nsec = 0;
+        uint64_t max_nsec = 0;
+    };
+    std::unordered_map<key, stat, key_hash> m;
+    std::vector<std::pair<key, uint64_t>> ran;
+    bool aggregate = false;
+    bool trace = false;
+};
+
 } // namespace tamerpriv
 } // namespace tamer
 #endif
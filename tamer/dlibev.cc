@@ -39,13 +39,16 @@ public:
     ~driver_libev();
 
     virtual void at_fd(int fd, int action, event<int> e);
-    virtual void at_time(const timeval &expiry, event<> e, bool bg);
+    using driver::at_time;
+    virtual void at_time(const timeval &expiry, event<> e, bool bg,
+                         const timeval &slack);
     virtual void at_asap(event<> e);
     virtual void at_preblock(event<> e);
     virtual void kill_fd(int fd);
 
     virtual void loop(loop_flags flags);
     virtual void break_loop();
+    virtual driver_stats stats() const;
 
     struct fdp {
         union {
@@ -73,7 +76,7 @@ public:
     union {
         ev_watcher w;
         ev_io io;
-    } sigwatcher_;
+    } sigwatcher_, postwatcher_;
 
     void update_fds();
     static void fd_disinterest(void* arg);
@@ -100,6 +103,9 @@ void libev_io_trigger(struct ev_loop*, ev_io* ev, int revents)
 void libev_timer_trigger(struct ev_loop *, ev_timer *, int) {
 }
 
+void libev_posttrigger(struct ev_loop *, ev_io *, int) {
+}
+
 void libev_sigtrigger(struct ev_loop *, ev_io *ev, int)
 {
     driver_libev *d = static_cast<driver_libev *>(ev->data);
@@ -116,11 +122,16 @@ driver_libev::driver_libev()
     ev_io_set(&sigwatcher_.io, sig_pipe[0], EV_READ);
     sigwatcher_.io.data = this;
     ev_io_start(eloop_, &sigwatcher_.io);
+
+    ev_init(&postwatcher_.w, (ev_watcher_type) libev_posttrigger);
+    ev_io_set(&postwatcher_.io, post_fd_[0], EV_READ);
+    ev_io_start(eloop_, &postwatcher_.io);
 }
 
 driver_libev::~driver_libev() {
     // Stop the special signal FD pipe.
     ev_io_stop(eloop_, &sigwatcher_.io);
+    ev_io_stop(eloop_, &postwatcher_.io);
     for (int fd = 0; fd < fds_.size(); ++fd) {
         ev_io_stop(eloop_, &fds_[fd].base_.io);
     }
@@ -162,6 +173,13 @@ void driver_libev::update_fds() {
         unsigned have_what = (ev_is_active(&x.base_.w) ? x.base_.io.events : 0) & (EV_READ | EV_WRITE);
         if (want_what != have_what) {
             fdactive_ += (want_what != 0) - (have_what != 0);
+            if (want_what == 0) {
+                ++stats_.fd_dels;
+            } else if (have_what == 0) {
+                ++stats_.fd_adds;
+            } else {
+                ++stats_.fd_mods;
+            }
             if (have_what != 0) {
                 ev_io_stop(eloop_, &x.base_.io);
             }
@@ -175,9 +193,11 @@ void driver_libev::update_fds() {
     }
 }
 
-void driver_libev::at_time(const timeval &expiry, event<> e, bool bg) {
+void driver_libev::at_time(const timeval &expiry, event<> e, bool bg,
+                           const timeval &slack) {
     if (e) {
-        timers_.push(expiry, e.__release_simple(), bg);
+        timers_.push(tamerpriv::timeval_nsec(expiry), e.__release_simple(),
+                     bg, tamerpriv::timeval_nsec(slack));
     }
 }
 
@@ -215,12 +235,14 @@ void driver_libev::loop(loop_flags flags) {
     int event_flags = EVRUN_ONCE;
     timers_.cull();
     if (!asap_.empty()
-        || (!timers_.empty() && !timercmp(&timers_.expiry(), &recent(), >))
+        || timers_.due(recent_nsec())
+        || has_posted()
         || sig_any_active
         || has_unblocked()) {
         event_flags |= EVRUN_NOWAIT;
     } else if (!timers_.has_foreground()
                && fdactive_ == 0
+               && nremote() == 0
                && sig_nforeground == 0) {
         // no foreground events!
         return;
@@ -230,9 +252,7 @@ void driver_libev::loop(loop_flags flags) {
             ev_periodic_set(&timerev.p, 0, 0, 0);
             timer_set = true;
         }
-        timeval to;
-        timersub(&timers_.expiry(), &recent(), &to);
-        timerev.p.offset = dtime(to);
+        timerev.p.offset = (timers_.expiry() - recent_nsec()) / 1e9;
         ev_periodic_again(eloop_, &timerev.p);
     } else if (timer_set) {
         ev_periodic_stop(eloop_, &timerev.p);
@@ -240,7 +260,9 @@ void driver_libev::loop(loop_flags flags) {
 
     // run the event loop, unless there's nothing it can do
     if (!(event_flags & EVRUN_NOWAIT) || fdactive_ != 0 || sig_ntotal != 0) {
+        stats_before_wait();
         ::ev_run(eloop_, event_flags);
+        stats_after_wait();
     }
 
     // process fd events
@@ -248,11 +270,17 @@ void driver_libev::loop(loop_flags flags) {
     run_unblocked();
 
     // process timer events
-    while (!timers_.empty() && !timercmp(&timers_.expiry(), &recent(), >)) {
+    while (timers_.due(recent_nsec())) {
         timers_.pop_trigger();
     }
     run_unblocked();
 
+    // process events posted from other threads
+    if (has_posted()) {
+        run_posted();
+        run_unblocked();
+    }
+
     // process asap events
     while (!asap_.empty()) {
         asap_.pop_trigger();
@@ -264,6 +292,15 @@ void driver_libev::loop(loop_flags flags) {
     }
 }
 
+driver_stats driver_libev::stats() const {
+    driver_stats s = driver::stats();
+    s.fds = fdactive_;
+    s.asap = asap_.size();
+    s.preblock = preblock_.size();
+    timers_.stats(s);
+    return s;
+}
+
 void driver_libev::break_loop() {
     ev_break(eloop_);
 }
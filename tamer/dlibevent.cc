@@ -35,13 +35,16 @@ class driver_libevent : public driver {
     ~driver_libevent();
 
     virtual void at_fd(int fd, int action, event<int> e);
-    virtual void at_time(const timeval &expiry, event<> e, bool bg);
+    using driver::at_time;
+    virtual void at_time(const timeval &expiry, event<> e, bool bg,
+                         const timeval &slack);
     virtual void at_asap(event<> e);
     virtual void at_preblock(event<> e);
     virtual void kill_fd(int fd);
 
     virtual void loop(loop_flags flags);
     virtual void break_loop();
+    virtual driver_stats stats() const;
 
     struct fdp {
         ::event base;
@@ -57,6 +60,7 @@ class driver_libevent : public driver {
     tamerpriv::driver_fdset<fdp> fds_;
     int fdactive_;
     ::event signal_base_;
+    ::event post_base_;
 
     tamerpriv::driver_timerset timers_;
 
@@ -85,6 +89,9 @@ void libevent_fdtrigger(int fd, short what, void *arg) {
 void libevent_timertrigger(int, short, void *) {
 }
 
+void libevent_posttrigger(int, short, void *) {
+}
+
 void libevent_sigtrigger(int, short, void *arg) {
     driver_libevent *d = static_cast<driver_libevent *>(arg);
     d->dispatch_signals();
@@ -105,10 +112,14 @@ driver_libevent::driver_libevent()
                 libevent_sigtrigger, this);
     ::event_priority_set(&signal_base_, 0);
     ::event_add(&signal_base_, 0);
+    ::event_set(&post_base_, post_fd_[0], EV_READ | EV_PERSIST,
+                libevent_posttrigger, this);
+    ::event_add(&post_base_, 0);
 }
 
 driver_libevent::~driver_libevent() {
     ::event_del(&signal_base_);
+    ::event_del(&post_base_);
 }
 
 void driver_libevent::fd_disinterest(void* arg) {
@@ -148,6 +159,13 @@ void driver_libevent::update_fds() {
             & (EV_READ | EV_WRITE);
         if (want_what != have_what) {
             fdactive_ += (want_what != 0) - (have_what != 0);
+            if (want_what == 0) {
+                ++stats_.fd_dels;
+            } else if (have_what == 0) {
+                ++stats_.fd_adds;
+            } else {
+                ++stats_.fd_mods;
+            }
             if (have_what != 0) {
                 ::event_del(&x.base);
             }
@@ -160,9 +178,11 @@ void driver_libevent::update_fds() {
     }
 }
 
-void driver_libevent::at_time(const timeval &expiry, event<> e, bool bg) {
+void driver_libevent::at_time(const timeval &expiry, event<> e, bool bg,
+                              const timeval &slack) {
     if (e) {
-        timers_.push(expiry, e.__release_simple(), bg);
+        timers_.push(tamerpriv::timeval_nsec(expiry), e.__release_simple(),
+                     bg, tamerpriv::timeval_nsec(slack));
     }
 }
 
@@ -198,12 +218,14 @@ void driver_libevent::loop(loop_flags flags)
     int event_flags = EVLOOP_ONCE;
     timers_.cull();
     if (!asap_.empty()
-        || (!timers_.empty() && !timercmp(&timers_.expiry(), &recent(), >))
+        || timers_.due(recent_nsec())
+        || has_posted()
         || sig_any_active
         || has_unblocked()) {
         event_flags |= EVLOOP_NONBLOCK;
     } else if (!timers_.has_foreground()
                && fdactive_ == 0
+               && nremote() == 0
                && sig_nforeground == 0) {
         // no foreground events!
         return;
@@ -212,14 +234,16 @@ void driver_libevent::loop(loop_flags flags)
             evtimer_set(&timerev, libevent_timertrigger, 0);
         }
         timer_set = true;
-        timeval timeout = timers_.expiry();
-        timersub(&timeout, &recent(), &timeout);
+        timeval timeout =
+            tamerpriv::nsec_timeval(timers_.expiry() - recent_nsec());
         evtimer_add(&timerev, &timeout);
     }
 
     // don't bother to run event loop if there is nothing it can do
     if (!(event_flags & EVLOOP_NONBLOCK) || fdactive_ != 0 || sig_ntotal != 0) {
+        stats_before_wait();
         ::event_loop(event_flags);
+        stats_after_wait();
     }
 
     // process fd events
@@ -228,15 +252,21 @@ void driver_libevent::loop(loop_flags flags)
 
     // process timer events
     if (!timers_.empty()) {
-        if (!(event_flags & EVLOOP_NONBLOCK)) {
+        if (timer_set && !(event_flags & EVLOOP_NONBLOCK)) {
             evtimer_del(&timerev);
         }
-        while (!timers_.empty() && !timercmp(&timers_.expiry(), &recent(), >)) {
+        while (timers_.due(recent_nsec())) {
             timers_.pop_trigger();
         }
         run_unblocked();
     }
 
+    // process events posted from other threads
+    if (has_posted()) {
+        run_posted();
+        run_unblocked();
+    }
+
     // process asap events
     while (!asap_.empty()) {
         asap_.pop_trigger();
@@ -248,6 +278,15 @@ void driver_libevent::loop(loop_flags flags)
     }
 }
 
+driver_stats driver_libevent::stats() const {
+    driver_stats s = driver::stats();
+    s.fds = fdactive_;
+    s.asap = asap_.size();
+    s.preblock = preblock_.size();
+    timers_.stats(s);
+    return s;
+}
+
 void driver_libevent::break_loop() {
     event_loopbreak();
 }
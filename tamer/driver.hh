@@ -25,9 +25,12 @@ enum init_flags {
     init_tamer = 1,
     init_libevent = 2,
     init_libev = 4,
+    init_uring = 8,
     init_sigpipe = 0x1000,
     init_strict = 0x2000,
-    init_no_epoll = 0x4000
+    init_no_epoll = 0x4000,
+    init_epoll_et = 0x8000,
+    init_timer_wheel = 0x10000
 };
 
 /** @brief  Initialize the Tamer event loop.
@@ -35,19 +38,51 @@ enum init_flags {
  *
  *  Call tamer::initialize at least once before registering any primitive
  *  Tamer events. The @a flags argument may contain one or more
- *  constants to request a specific driver (init_tamer, init_libevent, or
- *  init_libev).
+ *  constants to request a specific driver (init_tamer, init_libevent,
+ *  init_libev, or init_uring). The init_uring driver is the Tamer driver
+ *  with its epoll calls replaced by an io_uring submission ring, so that
+ *  all changes in fd interest are batched into one system call per loop
+ *  iteration. If io_uring is unavailable, Tamer falls back to the normal
+ *  Tamer driver unless init_strict is also given.
+ *
+ *  Add init_epoll_et to make the Tamer driver's epoll backend
+ *  edge-triggered. Each file descriptor is then registered with epoll once,
+ *  for all events, and the driver caches readiness between waits, so
+ *  changes in interest cost no system calls. In this mode a readiness
+ *  event means the file descriptor became ready since the last event of
+ *  its kind; callers should read or write until EAGAIN before waiting
+ *  again, as tamer::fd does. File descriptors should be closed with
+ *  tamer::fd::close or followed by driver::kill_fd; the driver notices a
+ *  raw close() only after the file descriptor has reported a hangup.
+ *
+ *  Add init_timer_wheel to keep the Tamer driver's timers in a
+ *  hierarchical timing wheel rather than a heap. Adding a timer then takes
+ *  constant time, and a timer whose event is triggered early, as with
+ *  tamer::with_timeout, is removed at once rather than when it reaches the
+ *  front. This suits programs with many long timeouts that rarely fire.
+ *  Setting the TAMER_TIMERS environment variable to "wheel" has the same
+ *  effect.
  *
  *  By default Tamer ignores the SIGPIPE signal, which is generally what
  *  event-driven programs want. Add init_sigpipe to @a flags if you
  *  want to turn off this behavior.
+ *
+ *  The driver is per thread: driver::main is thread-local, so a program
+ *  can run one event loop per thread by calling tamer::initialize and
+ *  tamer::loop in each. Each thread's events, closures, and file
+ *  descriptors belong to its own driver and must not be touched by other
+ *  threads. Signals are delivered to the thread that first calls
+ *  tamer::at_signal, and only that thread may register for them. Use the
+ *  Tamer driver (init_tamer or init_uring) for
+ *  more than one thread. To shard a server, open one listener per thread
+ *  with tcp_listen(port, backlog, tcp_listen_reuseport).
  */
 bool initialize(int flags = 0);
 
 /** @brief  Clean up the Tamer event loop.
  *
- *  Delete the driver. Should not be called unless all Tamer objects are
- *  deleted.
+ *  Delete the calling thread's driver. Should not be called unless all
+ *  Tamer objects are deleted.
  */
 void cleanup();
 
@@ -58,15 +93,27 @@ enum time_type_t {
 
 void set_time_type(time_type_t tt);
 
-/** @brief  Return a recent snapshot of the current time. */
+/** @brief  Return a recent snapshot of the current time.
+ *
+ *  Tamer's clock is monotonic. Its values start near the wall-clock time,
+ *  but do not follow later changes to the system clock, so timers are
+ *  unaffected by clock jumps. */
 inline const timeval& recent() {
     if (tamerpriv::need_recent) {
-        tamerpriv::recent = now();
-        tamerpriv::need_recent = false;
+        now_nsec();
     }
     return tamerpriv::recent;
 }
 
+/** @brief  Return a recent snapshot of the current time in nanoseconds.
+ *  @sa recent() */
+inline uint64_t recent_nsec() {
+    if (tamerpriv::need_recent) {
+        now_nsec();
+    }
+    return tamerpriv::recent_nsec;
+}
+
 /** @brief  Sets Tamer's current time to the current timestamp.
  */
 inline void set_recent() {
@@ -123,6 +170,28 @@ inline void at_fd_read(int fd, event<int> e) {
     driver::main->at_fd(fd, fd_read, e);
 }
 
+/** @brief  Start a completion-based I/O operation on a file descriptor.
+ *  @param  fd  File descriptor.
+ *  @param  io  Operation.
+ *  @param  e   Event.
+ *  @return  True if the operation was started.
+ *
+ *  Only drivers with driver::has_fd_io() support this; for others it
+ *  returns false and leaves @a e untouched. Otherwise the kernel performs
+ *  the operation and @a e is triggered with its result: a nonnegative byte
+ *  count (or, for fd_io_accept, file descriptor), or a negative error code.
+ *  Triggering @a e early cancels the operation. Cancels @a e when @a fd is
+ *  closed. The buffers named by @a io must remain valid until @a e is
+ *  triggered, but not after: an operation canceled early is detached
+ *  from them before the trigger returns. A canceled read or accept that
+ *  completes anyway is not lost; its data or connection is returned by
+ *  the next such operation on @a fd. A canceled write may still have
+ *  written its data.
+ */
+inline bool at_fd_io(int fd, const fd_io& io, event<int> e) {
+    return driver::main->at_fd_io(fd, io, std::move(e));
+}
+
 /** @brief  Register event for file descriptor writability.
  *  @param  fd  File descriptor.
  *  @param  e   Event.
@@ -148,6 +217,27 @@ inline void at_fd_shutdown(int fd, event<> e) {
     driver::main->at_fd(fd, fd_hangup, e);
 }
 
+/** @brief  Register event for a file descriptor's socket error queue.
+ *  @param  fd  File descriptor.
+ *  @param  e   Event.
+ *
+ *  Triggers @a e when @a fd reports an error condition, which for a
+ *  socket usually means messages, such as MSG_ZEROCOPY completions, are
+ *  waiting on its error queue. Once an fd's error queue has been waited
+ *  on, error conditions wake only its error-queue events, not its read or
+ *  write events, until driver::kill_fd; socket errors that end a
+ *  connection still wake readers and writers through the hangup. Only
+ *  drivers with driver::has_fd_errqueue() support this; for others @a e
+ *  is triggered only when @a fd is closed.
+ */
+inline void at_fd_errqueue(int fd, event<> e) {
+    driver::main->at_fd(fd, fd_errqueue, e);
+}
+
+inline void at_fd_errqueue(int fd, event<int> e) {
+    driver::main->at_fd(fd, fd_errqueue, e);
+}
+
 /** @brief  Register event for a given time.
  *  @param  expiry  Time.
  *  @param  e       Event.
@@ -185,6 +275,57 @@ inline void at_delay(double delay, event<> e, bool bg = false) {
     driver::main->at_delay(delay, e, bg);
 }
 
+/** @brief  Register event for a given time, with slack.
+ *  @param  expiry  Time.
+ *  @param  e       Event.
+ *  @param  bg      True if this is a background timer.
+ *  @param  slack   Allowed lateness.
+ *
+ *  Triggers @a e at some point between @a expiry and @a expiry + @a slack.
+ *  The driver fires timers whose windows overlap on a single wakeup, so
+ *  many timers with slack cost fewer wakeups than timers without. The
+ *  other timer functions use the default slack set by set_timer_slack().
+ */
+inline void at_time(const timeval& expiry, event<> e, bool bg,
+                    const timeval& slack) {
+    driver::main->at_time(expiry, e, bg, slack);
+}
+
+/** @brief  Register event for a given delay, with slack.
+ *  @param  delay  Delay time.
+ *  @param  e      Event.
+ *  @param  bg     True if this is a background timer.
+ *  @param  slack  Allowed lateness.
+ *
+ *  Triggers @a e between @a delay and @a delay + @a slack after
+ *  @c recent().
+ *  @sa at_time(const timeval&, event<>, bool, const timeval&)
+ */
+inline void at_delay(const timeval& delay, event<> e, bool bg,
+                     const timeval& slack) {
+    driver::main->at_delay(delay, e, bg, slack);
+}
+
+/** @overload */
+inline void at_delay(double delay, event<> e, bool bg, double slack) {
+    driver::main->at_delay(delay, e, bg, slack);
+}
+
+/** @brief  Set the default timer slack.
+ *  @param  slack  Allowed lateness.
+ *
+ *  Timers registered without explicit slack may fire up to @a slack late.
+ *  The initial default is zero. Applies to the current thread's driver.
+ */
+inline void set_timer_slack(const timeval& slack) {
+    driver::main->set_timer_slack(slack);
+}
+
+/** @overload */
+inline void set_timer_slack(double slack) {
+    driver::main->set_timer_slack(slack);
+}
+
 /** @brief  Register event for a given delay.
  *  @param  delay  Delay time.
  *  @param  e      Event.
@@ -221,12 +362,17 @@ inline void at_delay_usec(int delay, event<> e, bool bg = false) {
 /** @brief  Register event for signal occurrence.
  *  @param  signo  Signal number.
  *  @param  e      Event.
+ *  @return  True if @a e was registered.
  *
  *  Triggers @a e soon after @a signo is received.  The signal @a signo
  *  is blocked while @a e is triggered and unblocked afterwards.
+ *
+ *  Signals belong to the thread that first registers for one. In any
+ *  other thread, at_signal() registers nothing and returns false; @a e is
+ *  dropped, so a closure waiting only on it is unblocked.
  */
-inline void at_signal(int signo, event<> e) {
-    driver::at_signal(signo, e);
+inline bool at_signal(int signo, event<> e) {
+    return driver::at_signal(signo, e);
 }
 
 /** @brief  Register event to trigger soon.
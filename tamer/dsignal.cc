@@ -24,6 +24,7 @@ volatile sig_atomic_t driver::sig_any_active;
 int driver::sig_pipe[2] = { -1, -1 };
 unsigned driver::sig_nforeground = 0;
 unsigned driver::sig_ntotal = 0;
+driver* driver::sig_driver;
 
 extern "C" { typedef void (*tamer_sighandler)(int); }
 static int tamer_sigaction(int signo, tamer_sighandler handler)
@@ -81,7 +82,7 @@ static void tamer_signal_handler(int signo) {
 }
 
 
-void driver::at_signal(int signo, event<> trigger, signal_flags flags)
+bool driver::at_signal(int signo, event<> trigger, signal_flags flags)
 {
     assert(signo >= 0 && signo < NSIG);
 
@@ -94,7 +95,19 @@ void driver::at_signal(int signo, event<> trigger, signal_flags flags)
     }
 
     if (!trigger)               // special case forces creation of signal pipe
-        return;
+        return true;
+
+    // signals are dispatched by the driver of the first thread to register
+    // one; sig_handlers and the counts belong to that thread
+    driver* owner = __atomic_load_n(&sig_driver, __ATOMIC_ACQUIRE);
+    if (!owner && main) {
+        __atomic_compare_exchange_n(&sig_driver, &owner, main, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        owner = __atomic_load_n(&sig_driver, __ATOMIC_ACQUIRE);
+    }
+    if (owner && owner != main) {
+        return false;
+    }
 
     bool foreground = (flags & signal_background) == 0;
     trigger.at_trigger(make_event(sigcancelr, (signo << 1) + foreground));
@@ -104,12 +117,32 @@ void driver::at_signal(int signo, event<> trigger, signal_flags flags)
     sig_handlers[signo] += std::move(trigger);
     if (sigismember(&sig_dispatching, signo) == 0)
         tamer_sigaction(signo, tamer_signal_handler);
+    return true;
+}
+
+
+/** @brief  Test whether this driver dispatches signals.
+ *
+ *  Signal state is process-wide, so only one driver watches the signal
+ *  pipe: the driver of the thread that first called at_signal(), or, if
+ *  at_signal() was called before any driver existed, the first driver to
+ *  ask. */
+bool driver::owns_signals()
+{
+    driver* d = __atomic_load_n(&sig_driver, __ATOMIC_ACQUIRE);
+    if (!d) {
+        __atomic_compare_exchange_n(&sig_driver, &d, this, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        d = __atomic_load_n(&sig_driver, __ATOMIC_ACQUIRE);
+    }
+    return d == this;
 }
 
 
 void driver::dispatch_signals()
 {
     sig_any_active = 0;
+    ++stats_.signals;
 
     // kill crap data written to pipe
     char crap[64];
@@ -24,6 +24,8 @@
 #include <fcntl.h>
 #include <poll.h>
 #include <sstream>
+#include <algorithm>
+#include <vector>
 #if HAVE_SYS_EPOLL_H && !TAMER_NOEPOLL
 # define DTAMER_EPOLL 1
 # include <sys/epoll.h>
@@ -33,6 +35,18 @@
 #else
 # define DTAMER_EPOLL 0
 #endif
+#if HAVE_LINUX_IO_URING_H && !TAMER_NOURING
+# include <linux/io_uring.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <pthread.h>
+# if defined(__NR_io_uring_setup) && defined(IORING_SETUP_CLAMP)
+#  define DTAMER_URING 1
+# endif
+#endif
+#ifndef DTAMER_URING
+# define DTAMER_URING 0
+#endif
 #ifndef POLLRDHUP
 # define POLLRDHUP 0
 #endif
@@ -43,6 +57,18 @@ using tamerpriv::make_fd_callback;
 using tamerpriv::fd_callback_driver;
 using tamerpriv::fd_callback_fd;
 
+#if HAVE_EPOLL_PWAIT2
+// cleared if the kernel lacks epoll_pwait2
+bool epoll_pwait2_works = true;
+#endif
+
+inline timespec nsec_timespec(int64_t ns) {
+    timespec ts;
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+}
+
 class xpollfds {
 public:
     xpollfds();
@@ -146,16 +172,20 @@ void xpollfds::set_events(int fd, int events) {
 }
 
 #if DTAMER_EPOLL
+// Space for the events returned by one epoll_wait. Doubles, up to a
+// limit, each time a wait fills it, and halves again after a long run of
+// waits that use at most a quarter of it, so a burst does not pin the
+// largest array for good.
 class xepoll_eventset {
   public:
     xepoll_eventset()
-        : es_(new struct epoll_event[128]) {
+        : es_(new struct epoll_event[initial_size]), size_(initial_size) {
     }
     ~xepoll_eventset() {
         delete[] es_;
     }
     int size() const {
-        return 128;
+        return size_;
     }
     struct epoll_event* data() {
         return es_;
@@ -163,16 +193,260 @@ class xepoll_eventset {
     epoll_event& operator[](int i) {
         return es_[i];
     }
+    void adapt(int n) {
+        if (n == size_ && size_ < max_size) {
+            resize(size_ * 2);
+        } else if (n > size_ / 4 || size_ == initial_size) {
+            nsmall_ = 0;
+        } else if (++nsmall_ == shrink_after) {
+            resize(size_ / 2);
+        }
+    }
   private:
+    enum { initial_size = 128, max_size = 8192, shrink_after = 256 };
     struct epoll_event* es_;
+    int size_;
+    int nsmall_ = 0;
+
+    void resize(int size) {
+        delete[] es_;
+        size_ = size;
+        es_ = new struct epoll_event[size_];
+        nsmall_ = 0;
+    }
 };
 #endif
 
+#if DTAMER_URING
+// A child shares its parent's rings until it recreates them. Count forks so
+// the submission paths notice without a getpid() system call.
+unsigned uring_fork_count;
+
+void uring_atfork_child() {
+    ++uring_fork_count;
+}
+
+class xuring {
+  public:
+    xuring() = default;
+    ~xuring() {
+        close();
+    }
+
+    bool open(unsigned entries, unsigned cq_entries);
+    void close();
+    bool valid() const {
+        return ringfd_ >= 0;
+    }
+
+    inline io_uring_sqe* get_sqe();
+    inline unsigned pending() const;
+    int enter(unsigned min_complete);
+    int sync_cancel(uint64_t user_data, bool all = false);
+
+    inline unsigned cq_head() const;
+    inline unsigned cq_tail() const;
+    inline io_uring_cqe& cqe(unsigned pos) const;
+    inline void set_cq_head(unsigned head);
+
+  private:
+    int ringfd_ = -1;
+    void* sqmap_ = nullptr;
+    size_t sqmapsz_ = 0;
+    void* cqmap_ = nullptr;
+    size_t cqmapsz_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqessz_ = 0;
+
+    unsigned* sq_khead_;
+    unsigned* sq_ktail_;
+    unsigned sq_mask_;
+    unsigned sq_entries_;
+    unsigned sq_tail_;
+    unsigned* cq_khead_;
+    unsigned* cq_ktail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+};
+
+bool xuring::open(unsigned entries, unsigned cq_entries) {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+    p.cq_entries = cq_entries;
+    ringfd_ = syscall(__NR_io_uring_setup, entries, &p);
+    if (ringfd_ < 0 && errno == EINVAL) {
+        // older kernels lack CQSIZE/CLAMP
+        memset(&p, 0, sizeof(p));
+        ringfd_ = syscall(__NR_io_uring_setup, entries, &p);
+    }
+    if (ringfd_ < 0) {
+        return false;
+    }
+    fcntl(ringfd_, F_SETFD, FD_CLOEXEC);
+
+    sqmapsz_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqmapsz_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        sqmapsz_ = cqmapsz_ = std::max(sqmapsz_, cqmapsz_);
+    }
+    sqmap_ = mmap(nullptr, sqmapsz_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQ_RING);
+    if (sqmap_ == MAP_FAILED) {
+        sqmap_ = nullptr;
+        close();
+        return false;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        cqmap_ = sqmap_;
+    } else {
+        cqmap_ = mmap(nullptr, cqmapsz_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_CQ_RING);
+        if (cqmap_ == MAP_FAILED) {
+            cqmap_ = nullptr;
+            close();
+            return false;
+        }
+    }
+    sqessz_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqessz_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqmap_);
+    sq_khead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_ktail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_entries_ = p.sq_entries;
+    sq_tail_ = *sq_ktail_;
+    // SQ array is the identity map; sqes are used in ring order
+    unsigned* sqarray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for (unsigned i = 0; i != sq_entries_; ++i) {
+        sqarray[i] = i;
+    }
+
+    char* cq = static_cast<char*>(cqmap_);
+    cq_khead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_ktail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+}
+
+void xuring::close() {
+    if (sqes_) {
+        munmap(sqes_, sqessz_);
+        sqes_ = nullptr;
+    }
+    if (cqmap_ && cqmap_ != sqmap_) {
+        munmap(cqmap_, cqmapsz_);
+    }
+    if (sqmap_) {
+        munmap(sqmap_, sqmapsz_);
+    }
+    sqmap_ = cqmap_ = nullptr;
+    if (ringfd_ >= 0) {
+        ::close(ringfd_);
+        ringfd_ = -1;
+    }
+}
+
+inline unsigned xuring::pending() const {
+    return sq_tail_ - __atomic_load_n(sq_khead_, __ATOMIC_ACQUIRE);
+}
+
+inline io_uring_sqe* xuring::get_sqe() {
+    if (pending() == sq_entries_) {
+        // submission queue full: hand the batch to the kernel
+        enter(0);
+        if (pending() == sq_entries_) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sq_tail_ & sq_mask_];
+    memset(sqe, 0, sizeof(*sqe));
+    ++sq_tail_;
+    return sqe;
+}
+
+int xuring::enter(unsigned min_complete) {
+    __atomic_store_n(sq_ktail_, sq_tail_, __ATOMIC_RELEASE);
+    unsigned to_submit = pending();
+    if (to_submit == 0 && min_complete == 0) {
+        return 0;
+    }
+    return syscall(__NR_io_uring_enter, ringfd_, to_submit, min_complete,
+                   min_complete ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+}
+
+// IORING_REGISTER_SYNC_CANCEL (Linux 6.0), spelled out for older headers
+enum { xuring_register_sync_cancel = 24,
+       xuring_cancel_all = 1 << 0, xuring_cancel_any = 1 << 2 };
+struct xuring_sync_cancel_reg {
+    uint64_t addr;
+    int32_t fd;
+    uint32_t flags;
+    __kernel_timespec timeout;
+    uint64_t pad[4];
+};
+
+int xuring::sync_cancel(uint64_t user_data, bool all) {
+    // cancel the submitted request with user_data (or every request), and
+    // wait until the kernel is done with it; returns 0, -ENOENT if none
+    // matched, or -EINVAL if the kernel predates synchronous cancellation
+    xuring_sync_cancel_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.addr = user_data;
+    reg.fd = -1;
+    reg.flags = all ? xuring_cancel_all | xuring_cancel_any : 0;
+    reg.timeout.tv_sec = reg.timeout.tv_nsec = -1;
+    int r;
+    do {
+        r = syscall(__NR_io_uring_register, ringfd_,
+                    xuring_register_sync_cancel, &reg, 1);
+    } while (r < 0 && errno == EINTR);
+    return r < 0 ? -errno : 0;
+}
+
+inline unsigned xuring::cq_head() const {
+    return *cq_khead_;
+}
+
+inline unsigned xuring::cq_tail() const {
+    return __atomic_load_n(cq_ktail_, __ATOMIC_ACQUIRE);
+}
+
+inline io_uring_cqe& xuring::cqe(unsigned pos) const {
+    return cqes_[pos & cq_mask_];
+}
+
+inline void xuring::set_cq_head(unsigned head) {
+    __atomic_store_n(cq_khead_, head, __ATOMIC_RELEASE);
+}
+#endif
+
 class driver_tamer;
 
 struct fdp {
     inline fdp(driver_tamer*, int) {
     }
+    bool errqueue = false;      // error queue waited on; owns POLLERR
+#if DTAMER_EPOLL
+    int epoll_ready = 0;        // cached edge-triggered readiness
+    bool epoll_registered = false;
+    bool epoll_recheck = false; // hangup seen; registration may be stale
+#endif
+#if DTAMER_URING
+    unsigned uring_events = 0;  // events of the armed IORING_OP_POLL_ADD
+    unsigned uring_gen = 0;     // generation of the armed poll
+    unsigned uring_nio = 0;     // number of fd_io operations in flight
+    unsigned uring_norphan = 0; // ... of which have lost their events
+    bool uring_salvaged = false; // has results in uring_salvage_
+#endif
 };
 
 class driver_tamer : public driver {
@@ -181,23 +455,38 @@ public:
     ~driver_tamer();
 
     virtual void at_fd(int fd, int action, event<int> e);
-    virtual void at_time(const timeval &expiry, event<> e, bool bg);
+    using driver::at_time;
+    virtual void at_time(const timeval &expiry, event<> e, bool bg,
+                         const timeval &slack);
     virtual void at_asap(event<> e);
     virtual void at_preblock(event<> e);
     virtual void kill_fd(int fd);
 
+#if DTAMER_URING
+    virtual bool has_fd_io() const;
+    virtual bool at_fd_io(int fd, const fd_io& io, event<int> done);
+#endif
+    virtual bool has_fd_errqueue() const;
+
     virtual void set_error_handler(error_handler_type errh);
 
     virtual void loop(loop_flags flags);
     virtual void break_loop();
     virtual timeval next_wake() const;
     virtual void clear();
+    virtual driver_stats stats() const;
+
+#if DTAMER_URING
+    bool open_uring();
+#endif
 
 private:
     tamerpriv::driver_fdset<fdp> fds_;
     xpollfds pfds_;
 #if DTAMER_EPOLL
     int epollfd_ = -1;
+    xepoll_eventset epollnow_;
+    uint64_t epoll_saturations_ = 0;
 #endif
 
     tamerpriv::driver_timerset timers_;
@@ -206,21 +495,106 @@ private:
 
     bool loop_state_ = false;
     bool sig_pipe_ = false;
+    bool post_pipe_ = false;
 #if DTAMER_EPOLL
     bool epoll_sig_pipe_ = false;
+    bool epoll_post_ = false;
+    bool epoll_et_ = false;
     pid_t epoll_pid_;
     enum { EPOLL_MAX_ERRCOUNT = 32 };
     int epoll_errcount_;
+#endif
+#if DTAMER_URING
+    xuring uring_;
+    bool uring_direct_ = false; // synchronous cancellation works
+    bool uring_sig_pipe_ = false;
+    bool uring_post_ = false;
+    unsigned uring_fork_count_;
+    __kernel_timespec uring_timeout_;
+    enum { URING_ENTRIES = 256, URING_CQ_ENTRIES = 16384 };
+    enum { ud_poll = 0, ud_sig = 1, ud_timeout = 2, ud_remove = 3,
+           ud_io = 4, ud_cancel = 5, ud_post = 6 };
+
+    // An fd_io read or write works directly on the caller's buffers.
+    // Its event may go away before the kernel is done; the driver then
+    // cancels the operation synchronously (IORING_REGISTER_SYNC_CANCEL),
+    // so the caller may free its buffers as soon as the event is
+    // triggered. The canceled operation is orphaned: the driver keeps it
+    // until its final completion, saving any data it read (or connection
+    // it accepted) in the operation's bounce buffer for the next
+    // operation on the same fd. Operations started while an fd has
+    // orphans are deferred until the orphans finish, so data stays in
+    // order. Kernels without synchronous cancellation cannot make that
+    // promise, so there every operation goes through its bounce buffer,
+    // at most uring_bounce_max bytes at a time.
+    enum { uring_bounce_max = 65536, uring_io_max = 0x7FFFF000,
+           uring_iov_max = 1024 };
+    enum { uop_free = 0, uop_deferred, uop_active, uop_orphaned };
+    struct uring_op {
+        event<int> e;
+        int fd;
+        int op;
+        unsigned gen = 0;
+        int next_free;
+        int state = uop_free;
+        bool cancel_sent;
+        bool discard;           // orphan whose fd was closed
+        void* data;             // caller's buffer, iovec array, or sockaddr
+        size_t size;
+        socklen_t* addrlen;
+        bool direct;            // kernel uses the caller's buffers
+        size_t len;             // bytes transferred at most
+        std::unique_ptr<char[]> bounce;
+        size_t bounce_cap = 0;
+    };
+    struct uring_salvage {
+        int fd;
+        bool accept;
+        int result;
+        std::string data;       // bytes read, or uring_accept_space
+    };
+    struct uring_accept_space {
+        struct sockaddr_storage addr;
+        socklen_t addrlen;
+    };
+    std::vector<uring_op> uring_ops_;
+    int uring_free_op_ = -1;
+    unsigned uring_nactive_ = 0;
+    unsigned uring_nunsent_cancel_ = 0;
+    std::vector<uring_salvage> uring_salvage_;
 #endif
     int flags_;
     error_handler_type errh_ = 0;
 
     static void fd_disinterest(void* arg);
     void update_fds();
+    inline bool fds_empty() const;
+    int block_msec(int64_t blockns) const;
 #if DTAMER_EPOLL
     void report_epoll_error(int fd, bool waspresent, int events);
     inline void mark_epoll(int fd, bool waspresent, int events);
+    inline bool register_epoll_et(int fd, fdp& x);
     bool epoll_recreate();
+    void dispatch_epoll_et(int fd, int events);
+#endif
+#if DTAMER_URING
+    static inline uint64_t uring_data(int fd, unsigned gen, int kind);
+    inline void mark_uring(int fd, fdp& x, int events);
+    void report_uring_error(const char* what);
+    bool uring_recreate();
+    int uring_wait(int64_t blockns, bool sigs);
+    int uring_dispatch();
+    static void uring_io_disinterest(void* arg);
+    int uring_io_prepare(int fd, const fd_io& io);
+    bool uring_io_submit(int opi);
+    bool uring_io_send_cancel(int opi);
+    void uring_io_cancel(int opi);
+    void uring_io_detach(int opi);
+    void uring_io_complete(int opi, unsigned gen, int result);
+    void uring_io_finish(int opi, int result);
+    bool uring_io_unsalvage(int fd, const fd_io& io, event<int>& done);
+    void uring_io_release(int opi);
+    void uring_io_clear(int result);
 #endif
 };
 
@@ -228,15 +602,34 @@ private:
 driver_tamer::driver_tamer(int flags)
     : flags_(flags) {
 #if DTAMER_EPOLL
-    if (!(flags_ & init_no_epoll)) {
+    if (!(flags_ & (init_no_epoll | init_uring))) {
         epollfd_ = epoll_create1(EPOLL_CLOEXEC);
         epoll_pid_ = getpid();
+        epoll_et_ = (flags_ & init_epoll_et) != 0;
     }
     epoll_errcount_ = epollfd_ >= 0 ? 0 : EPOLL_MAX_ERRCOUNT;
 #else
     (void) flags_;
 #endif
+    if (flags_ & init_timer_wheel) {
+        timers_.use_wheel();
+    }
+}
+
+#if DTAMER_URING
+bool driver_tamer::open_uring() {
+    static int atfork_registered =
+        pthread_atfork(nullptr, nullptr, uring_atfork_child);
+    (void) atfork_registered;
+    uring_fork_count_ = uring_fork_count;
+    if (!uring_.open(URING_ENTRIES, URING_CQ_ENTRIES)) {
+        return false;
+    }
+    uring_direct_ = uring_.sync_cancel(uring_data(0, 0, ud_cancel))
+        == -ENOENT;
+    return true;
 }
+#endif
 
 driver_tamer::~driver_tamer() {
 #if DTAMER_EPOLL
@@ -250,6 +643,26 @@ void driver_tamer::set_error_handler(error_handler_type errh) {
     errh_ = errh;
 }
 
+#if DTAMER_EPOLL
+// edge-triggered readiness that satisfies each fd action, and the part of
+// that readiness used up by satisfying it (hangups and errors persist,
+// except that an error-queue waiter claims EPOLLERR)
+static const int epoll_action_events[nfdactions] = {
+    EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR,
+    EPOLLOUT | EPOLLHUP | EPOLLERR,
+    EPOLLRDHUP | EPOLLHUP | EPOLLERR,
+    EPOLLERR
+};
+static const int epoll_action_consumes[nfdactions] = {
+    EPOLLIN, EPOLLOUT, 0, EPOLLERR
+};
+
+static inline int epoll_action_mask(const fdp& x, int action) {
+    int m = epoll_action_events[action];
+    return x.errqueue && action != fd_errqueue ? m & ~EPOLLERR : m;
+}
+#endif
+
 void driver_tamer::fd_disinterest(void* arg) {
     driver_tamer* d = static_cast<driver_tamer*>(fd_callback_driver(arg));
     d->fds_.push_change(fd_callback_fd(arg));
@@ -260,6 +673,32 @@ void driver_tamer::at_fd(int fd, int action, event<int> e) {
     if (e && (unsigned) action < nfdactions) {
         fds_.expand(this, fd);
         auto& x = fds_[fd];
+        if (action == fd_errqueue) {
+            // From now on, an error condition on this fd usually means
+            // messages on its error queue, such as MSG_ZEROCOPY
+            // completions, rather than a socket error. Only error-queue
+            // waiters see it; real errors also raise hangups.
+            x.errqueue = true;
+        }
+#if DTAMER_EPOLL
+        // a cached hangup may belong to a file that was closed behind our
+        // back; check before reporting it again
+        if (epoll_et_ && (x.epoll_ready & epoll_action_mask(x, action))
+            && ((x.epoll_ready & epoll_action_consumes[action])
+                || !x.epoll_recheck
+                || !register_epoll_et(fd, x))) {
+            int ready = x.epoll_ready;
+            x.epoll_ready &= ~epoll_action_consumes[action];
+            if (action == 0) {
+                e.trigger(ready & EPOLLIN ? 0 : outcome::closed);
+            } else if (action == 1) {
+                e.trigger(ready & EPOLLOUT ? 0 : outcome::closed);
+            } else {
+                e.trigger(0);
+            }
+            return;
+        }
+#endif
         x.e[action] += std::move(e);
         tamerpriv::simple_event::at_trigger(x.e[action].__get_simple(),
                                             fd_disinterest,
@@ -274,21 +713,61 @@ void driver_tamer::kill_fd(int fd) {
         for (int action = 0; action < nfdactions; ++action) {
             x.e[action].trigger(-ECANCELED);
         }
+        x.errqueue = false;
+#if DTAMER_EPOLL
+        // closing the fd removed it from the epoll set
+        x.epoll_ready = 0;
+        x.epoll_registered = x.epoll_recheck = false;
+#endif
+#if DTAMER_URING
+        for (size_t i = 0; uring_nactive_ && i != uring_ops_.size(); ++i) {
+            if ((uring_ops_[i].state == uop_active
+                 || uring_ops_[i].state == uop_deferred)
+                && uring_ops_[i].fd == fd) {
+                uring_ops_[i].e.trigger(-ECANCELED);
+            }
+            if (uring_ops_[i].state == uop_orphaned
+                && uring_ops_[i].fd == fd) {
+                // the fd number may be reused before the final completion
+                uring_ops_[i].discard = true;
+            }
+        }
+        if (fds_[fd].uring_salvaged) {
+            fds_[fd].uring_salvaged = false;
+            for (auto it = uring_salvage_.begin();
+                 it != uring_salvage_.end(); ) {
+                if (it->fd != fd) {
+                    ++it;
+                    continue;
+                }
+                if (it->accept) {
+                    close(it->result);
+                }
+                it = uring_salvage_.erase(it);
+            }
+        }
+#endif
         fds_.push_change(fd);
     }
 }
 
+bool driver_tamer::has_fd_errqueue() const {
+    return true;
+}
+
 static inline int poll_events(const tamerpriv::driver_fd<fdp>& x) {
     return (x.e[0] ? int(POLLIN | POLLRDHUP) : 0)
         | (x.e[1] ? int(POLLOUT) : 0)
-        | (x.e[2] ? int(POLLRDHUP) : 0);
+        | (x.e[2] ? int(POLLRDHUP) : 0)
+        | (x.e[3] ? int(POLLERR) : 0);
 }
 
 #if DTAMER_EPOLL
 static inline int epoll_events(const tamerpriv::driver_fd<fdp>& x) {
     return (x.e[0] ? int(EPOLLIN | EPOLLRDHUP) : 0)
         | (x.e[1] ? int(EPOLLOUT) : 0)
-        | (x.e[2] ? int(EPOLLRDHUP) : 0);
+        | (x.e[2] ? int(EPOLLRDHUP) : 0)
+        | (x.e[3] ? int(EPOLLERR) : 0);
 }
 
 void driver_tamer::report_epoll_error(int fd, bool waspresent, int events) {
@@ -317,10 +796,13 @@ inline void driver_tamer::mark_epoll(int fd, bool waspresent, int events) {
         int action;
         if (!events) {
             action = EPOLL_CTL_DEL;
+            ++stats_.fd_dels;
         } else if (waspresent) {
             action = EPOLL_CTL_MOD;
+            ++stats_.fd_mods;
         } else {
             action = EPOLL_CTL_ADD;
+            ++stats_.fd_adds;
         }
         int r = epoll_ctl(epollfd_, action, fd, &ev);
         if (r < 0) {
@@ -329,43 +811,758 @@ inline void driver_tamer::mark_epoll(int fd, bool waspresent, int events) {
     }
 }
 
+// Register fd with the edge-triggered epoll set. An fd is registered once
+// and stays registered until kill_fd, since fds are closed with fd::close.
+// A raw close() is noticed lazily: after a hangup the fd is added again
+// before its next wait. EEXIST then means the registration (and cached
+// readiness) is still good; success means the fd number was closed and
+// reused, so the cache is stale; and EBADF means the fd is gone, which
+// reads as a hangup. Returns true iff the cached readiness was dropped.
+inline bool driver_tamer::register_epoll_et(int fd, fdp& x) {
+    if (epollfd_ >= 0 && (!x.epoll_registered || x.epoll_recheck)) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        ++stats_.fd_adds;
+        int r = epoll_ctl(epollfd_, EPOLL_CTL_ADD, fd, &ev);
+        if (r == 0) {
+            // the new registration will report current readiness
+            x.epoll_ready = 0;
+            x.epoll_registered = true;
+            x.epoll_recheck = false;
+            return true;
+        } else if (errno == EEXIST) {
+            x.epoll_registered = true;
+        } else if (errno == EBADF) {
+            x.epoll_ready = EPOLLHUP;
+            x.epoll_registered = false;
+        } else {
+            report_epoll_error(fd, false, ev.events);
+        }
+        // keep checking while a cached hangup is reported
+        x.epoll_recheck = (x.epoll_ready & EPOLLHUP) != 0;
+    }
+    return false;
+}
+
+void driver_tamer::dispatch_epoll_et(int fd, int events) {
+    auto& x = fds_[fd];
+    x.epoll_ready |= events;
+    if (events & EPOLLHUP) {
+        // the file may be closed behind our back after this
+        x.epoll_recheck = true;
+    }
+    for (int action = 0; action < fd_errqueue; ++action) {
+        if (x.e[action] && (x.epoll_ready & epoll_action_mask(x, action))) {
+            int ready = x.epoll_ready;
+            x.epoll_ready &= ~epoll_action_consumes[action];
+            if (action == 0) {
+                x.e[0].trigger(ready & EPOLLIN ? 0 : outcome::closed);
+            } else if (action == 1) {
+                x.e[1].trigger(ready & EPOLLOUT ? 0 : outcome::closed);
+            } else {
+                x.e[2].trigger(0);
+            }
+        }
+    }
+    // the error-queue waiter claims EPOLLERR after the others have seen it
+    if (x.e[3] && (x.epoll_ready & EPOLLERR)) {
+        x.epoll_ready &= ~EPOLLERR;
+        x.e[3].trigger(0);
+    }
+}
+
 bool driver_tamer::epoll_recreate() {
     while (epollfd_ < 0
            && epoll_errcount_ < EPOLL_MAX_ERRCOUNT
            && (epollfd_ = epoll_create1(EPOLL_CLOEXEC)) >= 0) {
+        if (epoll_et_) {
+            // registrations were lost with the old epoll fd; the new
+            // registrations will report current readiness
+            for (int fd = 0; fd < fds_.size(); ++fd) {
+                fds_[fd].epoll_ready = 0;
+                fds_[fd].epoll_registered = fds_[fd].epoll_recheck = false;
+            }
+        }
         auto endp = pfds_.end();
         for (auto p = pfds_.begin(); p != endp; ++p) {
-            mark_epoll(p->fd, false, epoll_events(fds_[p->fd]));
+            if (epoll_et_) {
+                register_epoll_et(p->fd, fds_[p->fd]);
+            } else {
+                mark_epoll(p->fd, false, epoll_events(fds_[p->fd]));
+            }
         }
         if (epoll_sig_pipe_) {
             mark_epoll(sig_pipe[0], false, int(EPOLLIN | EPOLLRDHUP));
         }
+        if (epoll_post_) {
+            mark_epoll(post_fd_[0], false, int(EPOLLIN));
+        }
         epoll_pid_ = getpid();
     }
     return epollfd_ >= 0;
 }
 #endif
 
+#if DTAMER_URING
+inline uint64_t driver_tamer::uring_data(int fd, unsigned gen, int kind) {
+    return (uint64_t(gen) << 32) | (uint64_t(unsigned(fd)) << 3) | kind;
+}
+
+inline void driver_tamer::mark_uring(int fd, fdp& x, int events) {
+    // Poll registrations are one-shot, so a fired poll leaves
+    // uring_events == 0 and is re-armed here. Changing the mask cancels the
+    // old poll; its stale completion is ignored by generation.
+    if (x.uring_events == unsigned(events)) {
+        return;
+    }
+    if (x.uring_events) {
+        if (io_uring_sqe* sqe = uring_.get_sqe()) {
+            sqe->opcode = IORING_OP_POLL_REMOVE;
+            sqe->fd = -1;
+            sqe->addr = uring_data(fd, x.uring_gen, ud_poll);
+            sqe->user_data = uring_data(fd, 0, ud_remove);
+            ++stats_.fd_dels;
+        }
+    }
+    ++x.uring_gen;
+    x.uring_events = 0;
+    if (events) {
+        if (io_uring_sqe* sqe = uring_.get_sqe()) {
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = fd;
+            sqe->poll32_events = events;
+            sqe->user_data = uring_data(fd, x.uring_gen, ud_poll);
+            x.uring_events = events;
+            ++stats_.fd_adds;
+        }
+    }
+}
+
+void driver_tamer::report_uring_error(const char* what) {
+    // fall back to epoll (or poll); pfds_ holds the current interest set
+    int uring_errno = errno;
+    if (errh_) {
+        char msg[1024];
+        snprintf(msg, sizeof(msg), "%s failure, falling back", what);
+        errh_(-1, uring_errno, msg);
+    }
+    if (uring_direct_ && uring_nactive_) {
+        // the kernel must be done with callers' buffers
+        uring_.sync_cancel(0, true);
+    }
+    uring_.close();
+    uring_io_clear(-ECANCELED);
+# if DTAMER_EPOLL
+    if (!(flags_ & init_no_epoll)) {
+        epoll_errcount_ = 0;
+    }
+# endif
+}
+
+bool driver_tamer::uring_recreate() {
+    uring_.close();
+    uring_io_clear(-ECANCELED);
+    uring_sig_pipe_ = false;
+    uring_post_ = false;
+    if (!open_uring()) {
+        report_uring_error("io_uring_setup");
+        return false;
+    }
+    auto endp = pfds_.end();
+    for (auto p = pfds_.begin(); p != endp; ++p) {
+        fdp& x = fds_[p->fd];
+        x.uring_events = 0;
+        mark_uring(p->fd, x, p->events);
+    }
+    return true;
+}
+
+int driver_tamer::uring_wait(int64_t blockns, bool sigs) {
+    if (!uring_sig_pipe_ && sigs) {
+        if (io_uring_sqe* sqe = uring_.get_sqe()) {
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = sig_pipe[0];
+            sqe->poll32_events = POLLIN | POLLRDHUP;
+            sqe->user_data = uring_data(sig_pipe[0], 0, ud_sig);
+            uring_sig_pipe_ = true;
+        }
+    }
+    if (!uring_post_ && post_fd_[0] >= 0) {
+        if (io_uring_sqe* sqe = uring_.get_sqe()) {
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = post_fd_[0];
+            sqe->poll32_events = POLLIN;
+            sqe->user_data = uring_data(post_fd_[0], 0, ud_post);
+            uring_post_ = true;
+        }
+    }
+    for (size_t i = 0; uring_nunsent_cancel_ && i != uring_ops_.size(); ++i) {
+        uring_op& op = uring_ops_[i];
+        if (op.state == uop_orphaned && !op.cancel_sent
+            && uring_io_send_cancel(i)) {
+            --uring_nunsent_cancel_;
+        }
+    }
+    if (uring_.cq_head() != uring_.cq_tail()) {
+        blockns = 0;
+    }
+    if (blockns > 0) {
+        // completes after the first other completion, or at the deadline,
+        // so at most one timeout is ever outstanding
+        if (io_uring_sqe* sqe = uring_.get_sqe()) {
+            uring_timeout_.tv_sec = blockns / 1000000000;
+            uring_timeout_.tv_nsec = blockns % 1000000000;
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uintptr_t>(&uring_timeout_);
+            sqe->len = 1;
+            sqe->off = 1;
+            sqe->user_data = uring_data(-1, 0, ud_timeout);
+        }
+    }
+    int r = uring_.enter(blockns != 0);
+    if (r < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN
+        && errno != ETIME) {
+        report_uring_error("io_uring_enter");
+        return -1;
+    }
+    return 0;
+}
+
+int driver_tamer::uring_dispatch() {
+    int eventcount = 0;
+    unsigned head = uring_.cq_head(), tail = uring_.cq_tail();
+    for (; head != tail; ++head) {
+        io_uring_cqe& cqe = uring_.cqe(head);
+        uint64_t ud = cqe.user_data;
+        int events = cqe.res;
+        if (int(ud & 7) == ud_io) {
+            uring_io_complete(int(unsigned(ud) >> 3), unsigned(ud >> 32),
+                              events);
+            ++eventcount;
+            continue;
+        } else if (int(ud & 7) == ud_sig) {
+            uring_sig_pipe_ = false;
+            continue;
+        } else if (int(ud & 7) == ud_post) {
+            uring_post_ = false;
+            continue;
+        } else if (int(ud & 7) != ud_poll) {
+            continue;
+        }
+        int fd = int(unsigned(ud) >> 3);
+        auto& x = fds_[fd];
+        if (x.uring_gen != unsigned(ud >> 32) || !x.uring_events) {
+            continue;
+        }
+        x.uring_events = 0;
+        fds_.push_change(fd);
+        if (events < 0) {
+            events = POLLERR;
+        } else if (events & POLLERR) {
+            if (x.e[3]) {
+                x.e[3].trigger(0);
+            }
+            if (x.errqueue) {
+                events &= ~POLLERR;
+            }
+        }
+        ++eventcount;
+        if (events & int(POLLIN | POLLRDHUP | POLLNVAL | POLLERR | POLLHUP)) {
+            x.e[0].trigger(events & POLLIN ? 0 : outcome::closed);
+        }
+        if (events & int(POLLOUT | POLLNVAL | POLLERR | POLLHUP)) {
+            x.e[1].trigger(events & POLLOUT ? 0 : outcome::closed);
+        }
+        if (events & int(POLLRDHUP | POLLNVAL | POLLERR | POLLHUP)) {
+            x.e[2].trigger(0);
+        }
+    }
+    uring_.set_cq_head(head);
+    return eventcount;
+}
+
+bool driver_tamer::has_fd_io() const {
+    return uring_.valid();
+}
+
+bool driver_tamer::at_fd_io(int fd, const fd_io& io, event<int> done) {
+    assert(fd >= 0);
+    if (uring_.valid() && uring_fork_count_ != uring_fork_count) {
+        uring_recreate();
+    }
+    if (!uring_.valid()) {
+        return false;
+    } else if (!done) {
+        return true;
+    }
+    fds_.expand(this, fd);
+    fdp& x = fds_[fd];
+    if (x.uring_salvaged && uring_io_unsalvage(fd, io, done)) {
+        return true;
+    }
+    int opi = uring_io_prepare(fd, io);
+    if (opi < 0) {
+        return false;
+    }
+    uring_op& op = uring_ops_[opi];
+    if (x.uring_norphan != 0) {
+        op.state = uop_deferred;
+    } else if (!uring_io_submit(opi)) {
+        uring_io_release(opi);
+        return false;
+    }
+    op.e = std::move(done);
+    ++uring_nactive_;
+    tamerpriv::simple_event::at_trigger(op.e.__get_simple(),
+                                        uring_io_disinterest,
+                                        make_fd_callback(this, opi));
+    return true;
+}
+
+int driver_tamer::uring_io_prepare(int fd, const fd_io& io) {
+    // size the transfer; without direct I/O, size the bounce buffer and
+    // copy outgoing data into it
+    bool direct = false;
+    size_t len;
+    switch (io.op) {
+    case fd_io_read:
+    case fd_io_write:
+        direct = uring_direct_;
+        len = std::min(io.size, size_t(direct ? uring_io_max
+                                       : uring_bounce_max));
+        break;
+    case fd_io_readv:
+    case fd_io_writev: {
+        const struct iovec* iov = static_cast<const struct iovec*>(io.data);
+        direct = uring_direct_;
+        size_t max = direct ? uring_io_max : uring_bounce_max;
+        size_t n = direct ? std::min(io.size, size_t(uring_iov_max)) : io.size;
+        len = 0;
+        for (size_t i = 0; i != n && len < max; ++i) {
+            len += iov[i].iov_len;
+        }
+        len = std::min(len, max);
+        break;
+    }
+    case fd_io_accept:
+        len = sizeof(uring_accept_space);
+        break;
+    case fd_io_connect:
+        len = std::min(io.size, sizeof(struct sockaddr_storage));
+        break;
+    default:
+        return -1;
+    }
+
+    int opi = uring_free_op_;
+    if (opi >= 0) {
+        uring_free_op_ = uring_ops_[opi].next_free;
+    } else {
+        opi = uring_ops_.size();
+        uring_ops_.emplace_back();
+    }
+    uring_op& op = uring_ops_[opi];
+    op.fd = fd;
+    op.op = io.op;
+    op.data = io.data;
+    op.size = io.size;
+    op.addrlen = io.addrlen;
+    op.direct = direct;
+    op.len = len;
+    op.cancel_sent = op.discard = false;
+    ++op.gen;
+    if (direct) {
+        return opi;
+    }
+    if (op.bounce_cap < len) {
+        op.bounce.reset(new char[len]);
+        op.bounce_cap = len;
+    }
+
+    char* b = op.bounce.get();
+    if (io.op == fd_io_write || io.op == fd_io_connect) {
+        memcpy(b, io.data, len);
+    } else if (io.op == fd_io_writev) {
+        const struct iovec* iov = static_cast<const struct iovec*>(io.data);
+        for (size_t i = 0, pos = 0; pos != len; ++i) {
+            size_t n = std::min(iov[i].iov_len, len - pos);
+            memcpy(b + pos, iov[i].iov_base, n);
+            pos += n;
+        }
+    } else if (io.op == fd_io_accept) {
+        uring_accept_space* as = reinterpret_cast<uring_accept_space*>(b);
+        as->addrlen = sizeof(as->addr);
+    }
+    return opi;
+}
+
+bool driver_tamer::uring_io_submit(int opi) {
+    io_uring_sqe* sqe = uring_.get_sqe();
+    if (!sqe && uring_.enter(0) >= 0) {
+        sqe = uring_.get_sqe();
+    }
+    if (!sqe) {
+        return false;
+    }
+    uring_op& op = uring_ops_[opi];
+    char* b = op.bounce.get();
+    sqe->fd = op.fd;
+    sqe->addr = reinterpret_cast<uintptr_t>(op.direct ? op.data : b);
+    switch (op.op) {
+    case fd_io_read:
+    case fd_io_readv:
+        if (op.direct && op.op == fd_io_readv) {
+            sqe->opcode = IORING_OP_READV;
+            sqe->len = std::min(op.size, size_t(uring_iov_max));
+        } else {
+            sqe->opcode = IORING_OP_READ;
+            sqe->len = op.len;
+        }
+        sqe->off = uint64_t(-1);
+        break;
+    case fd_io_write:
+    case fd_io_writev:
+        if (op.direct && op.op == fd_io_writev) {
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->len = std::min(op.size, size_t(uring_iov_max));
+        } else {
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->len = op.len;
+        }
+        sqe->off = uint64_t(-1);
+        break;
+    case fd_io_accept: {
+        uring_accept_space* as = reinterpret_cast<uring_accept_space*>(b);
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->addr = reinterpret_cast<uintptr_t>(&as->addr);
+        sqe->addr2 = reinterpret_cast<uintptr_t>(&as->addrlen);
+        sqe->accept_flags = SOCK_NONBLOCK;
+        break;
+    }
+    case fd_io_connect:
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->off = op.len;
+        break;
+    }
+    sqe->user_data = uring_data(opi, op.gen, ud_io);
+    op.state = uop_active;
+    ++fds_[op.fd].uring_nio;
+    return true;
+}
+
+void driver_tamer::uring_io_disinterest(void* arg) {
+    driver_tamer* d = static_cast<driver_tamer*>(fd_callback_driver(arg));
+    d->uring_io_cancel(fd_callback_fd(arg));
+}
+
+bool driver_tamer::uring_io_send_cancel(int opi) {
+    io_uring_sqe* sqe = uring_.get_sqe();
+    if (!sqe) {
+        return false;
+    }
+    uring_op& op = uring_ops_[opi];
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = uring_data(opi, op.gen, ud_io);
+    sqe->user_data = uring_data(opi, 0, ud_cancel);
+    op.cancel_sent = true;
+    return true;
+}
+
+void driver_tamer::uring_io_cancel(int opi) {
+    // The operation's event was triggered (or destroyed) before its
+    // completion arrived. A deferred operation simply goes away. A
+    // submitted one is orphaned and canceled; a direct operation is
+    // detached from the caller's buffers right away, any other keeps its
+    // bounce buffer until the final completion arrives.
+    uring_op& op = uring_ops_[opi];
+    if (op.state == uop_deferred) {
+        --uring_nactive_;
+        uring_io_release(opi);
+    } else if (op.state == uop_active) {
+        op.state = uop_orphaned;
+        ++fds_[op.fd].uring_norphan;
+        if (op.direct) {
+            uring_io_detach(opi);
+        } else if (!uring_io_send_cancel(opi)) {
+            // retried before the next io_uring_enter
+            ++uring_nunsent_cancel_;
+        } else {
+            uring_.enter(0);
+        }
+    }
+}
+
+void driver_tamer::uring_io_detach(int opi) {
+    // Cancel a direct operation and wait until the kernel is done with the
+    // caller's buffers. A read that completed anyway saves its data in the
+    // bounce buffer, where uring_io_complete will find it.
+    uring_op& op = uring_ops_[opi];
+    uint64_t ud = uring_data(opi, op.gen, ud_io);
+    uring_.enter(0);            // the request may not be submitted yet
+    uring_.sync_cancel(ud);
+    op.cancel_sent = true;
+    if (op.op != fd_io_read && op.op != fd_io_readv) {
+        return;
+    }
+    size_t len = op.len;        // if the completion is not yet visible
+    for (unsigned h = uring_.cq_head(); h != uring_.cq_tail(); ++h) {
+        if (uring_.cqe(h).user_data == ud) {
+            len = std::max(uring_.cqe(h).res, 0);
+            break;
+        }
+    }
+    if (op.bounce_cap < len) {
+        op.bounce.reset(new char[len]);
+        op.bounce_cap = len;
+    }
+    char* b = op.bounce.get();
+    if (op.op == fd_io_read) {
+        memcpy(b, op.data, len);
+    } else {
+        const struct iovec* iov = static_cast<const struct iovec*>(op.data);
+        for (size_t i = 0, pos = 0; pos != len; ++i) {
+            size_t n = std::min(iov[i].iov_len, len - pos);
+            memcpy(b + pos, iov[i].iov_base, n);
+            pos += n;
+        }
+    }
+}
+
+void driver_tamer::uring_io_complete(int opi, unsigned gen, int result) {
+    if (opi < 0 || unsigned(opi) >= uring_ops_.size()) {
+        return;
+    }
+    uring_op& op = uring_ops_[opi];
+    if (op.gen != gen
+        || (op.state != uop_active && op.state != uop_orphaned)) {
+        return;
+    }
+    int fd = op.fd;
+    fdp& x = fds_[fd];
+    --x.uring_nio;
+    if (op.state == uop_active) {
+        uring_io_finish(opi, result);
+        return;
+    }
+
+    if (!op.cancel_sent) {
+        --uring_nunsent_cancel_;
+    }
+    if (op.discard) {
+        if (result >= 0 && op.op == fd_io_accept) {
+            close(result);
+        }
+    } else if (result > 0 && (op.op == fd_io_read || op.op == fd_io_readv)) {
+        uring_salvage_.push_back(uring_salvage{fd, false, result,
+                    std::string(op.bounce.get(), result)});
+        x.uring_salvaged = true;
+    } else if (result >= 0 && op.op == fd_io_accept) {
+        uring_accept_space* as =
+            reinterpret_cast<uring_accept_space*>(op.bounce.get());
+        uring_salvage_.push_back(uring_salvage{fd, true, result,
+                    std::string(reinterpret_cast<char*>(as), sizeof(*as))});
+        x.uring_salvaged = true;
+    }
+    --uring_nactive_;
+    uring_io_release(opi);
+
+    // start operations deferred behind the orphans
+    if (--x.uring_norphan == 0) {
+        for (size_t i = 0; i != uring_ops_.size(); ++i) {
+            uring_op& dop = uring_ops_[i];
+            if (dop.state != uop_deferred || dop.fd != fd) {
+                continue;
+            }
+            if (fds_[fd].uring_salvaged) {
+                fd_io io(dop.op, dop.data, dop.size, dop.addrlen);
+                event<int> e = std::move(dop.e);
+                --uring_nactive_;
+                uring_io_release(i);
+                if (!uring_io_unsalvage(fd, io, e)) {
+                    e.trigger(-EAGAIN);
+                }
+            } else if (!uring_io_submit(i)) {
+                uring_io_finish(i, -EAGAIN);
+            }
+        }
+    }
+}
+
+void driver_tamer::uring_io_finish(int opi, int result) {
+    // deliver an operation's result to its caller and free it
+    uring_op& op = uring_ops_[opi];
+    const char* b = op.bounce.get();
+    if (op.direct) {
+        // the kernel already filled the caller's buffers
+    } else if (result > 0 && op.op == fd_io_read) {
+        memcpy(op.data, b, result);
+    } else if (result > 0 && op.op == fd_io_readv) {
+        const struct iovec* iov = static_cast<const struct iovec*>(op.data);
+        for (size_t i = 0, pos = 0; pos != size_t(result); ++i) {
+            size_t n = std::min(iov[i].iov_len, size_t(result) - pos);
+            memcpy(iov[i].iov_base, b + pos, n);
+            pos += n;
+        }
+    } else if (result >= 0 && op.op == fd_io_accept && op.data) {
+        const uring_accept_space* as =
+            reinterpret_cast<const uring_accept_space*>(b);
+        memcpy(op.data, &as->addr, std::min(*op.addrlen, as->addrlen));
+        *op.addrlen = as->addrlen;
+    }
+    event<int> e = std::move(op.e);
+    --uring_nactive_;
+    uring_io_release(opi);
+    e.trigger(result);
+}
+
+bool driver_tamer::uring_io_unsalvage(int fd, const fd_io& io,
+                                      event<int>& done) {
+    // complete a read or accept from results saved from an orphan
+    bool is_read = io.op == fd_io_read || io.op == fd_io_readv;
+    if (!is_read && io.op != fd_io_accept) {
+        return false;
+    }
+    auto it = uring_salvage_.begin();
+    while (it != uring_salvage_.end()
+           && (it->fd != fd || it->accept == is_read)) {
+        ++it;
+    }
+    if (it == uring_salvage_.end()) {
+        return false;
+    }
+    int result;
+    if (io.op == fd_io_read) {
+        result = std::min(it->data.length(), io.size);
+        memcpy(io.data, it->data.data(), result);
+    } else if (io.op == fd_io_readv) {
+        const struct iovec* iov = static_cast<const struct iovec*>(io.data);
+        size_t pos = 0;
+        for (size_t i = 0; i != io.size && pos != it->data.length(); ++i) {
+            size_t n = std::min(iov[i].iov_len, it->data.length() - pos);
+            memcpy(iov[i].iov_base, it->data.data() + pos, n);
+            pos += n;
+        }
+        result = pos;
+    } else {
+        const uring_accept_space* as =
+            reinterpret_cast<const uring_accept_space*>(it->data.data());
+        if (io.data) {
+            memcpy(io.data, &as->addr, std::min(*io.addrlen, as->addrlen));
+            *io.addrlen = as->addrlen;
+        }
+        result = it->result;
+    }
+    if (is_read && size_t(result) < it->data.length()) {
+        it->data.erase(0, result);
+    } else {
+        uring_salvage_.erase(it);
+        fds_[fd].uring_salvaged = false;
+        for (auto& s : uring_salvage_) {
+            fds_[fd].uring_salvaged = fds_[fd].uring_salvaged || s.fd == fd;
+        }
+    }
+    done.trigger(result);
+    return true;
+}
+
+void driver_tamer::uring_io_release(int opi) {
+    uring_op& op = uring_ops_[opi];
+    op.e = event<int>();
+    op.state = uop_free;
+    op.next_free = uring_free_op_;
+    uring_free_op_ = opi;
+}
+
+void driver_tamer::uring_io_clear(int result) {
+    // complete every operation; used when the ring goes away
+    for (size_t i = 0; i != uring_ops_.size(); ++i) {
+        uring_op& op = uring_ops_[i];
+        if (op.state == uop_active || op.state == uop_deferred) {
+            uring_io_finish(i, result);
+        } else if (op.state == uop_orphaned) {
+            --uring_nactive_;
+            uring_io_release(i);
+        }
+    }
+    for (auto& s : uring_salvage_) {
+        if (s.accept) {
+            close(s.result);
+        }
+    }
+    uring_salvage_.clear();
+    uring_nunsent_cancel_ = 0;
+    for (int fd = 0; fd < fds_.size(); ++fd) {
+        fdp& x = fds_[fd];
+        x.uring_nio = x.uring_norphan = 0;
+        x.uring_salvaged = false;
+    }
+}
+#endif
+
 void driver_tamer::update_fds() {
     int fd;
     while ((fd = fds_.pop_change()) >= 0) {
         tamerpriv::driver_fd<fdp>& x = fds_[fd];
         int old_events = pfds_.events(fd);
         int new_events = poll_events(x);
+#if DTAMER_URING
+        if (uring_.valid()) {
+            mark_uring(fd, x, new_events);
+        }
+#endif
+#if DTAMER_EPOLL
+        if (epoll_et_ && new_events
+            && (!x.epoll_registered || x.epoll_recheck)) {
+            register_epoll_et(fd, x);
+            if (x.epoll_ready) {
+                dispatch_epoll_et(fd, 0);
+            }
+        }
+#endif
         if (old_events == new_events) {
             continue;
         }
 
         pfds_.set_events(fd, new_events);
 #if DTAMER_EPOLL
-        mark_epoll(fd, old_events != 0, epoll_events(x));
+        if (!epoll_et_) {
+            mark_epoll(fd, old_events != 0, epoll_events(x));
+        }
+#endif
+    }
+}
+
+inline bool driver_tamer::fds_empty() const {
+#if DTAMER_URING
+    if (uring_nactive_ != 0) {
+        return false;
+    }
 #endif
+    return pfds_.size() <= unsigned(sig_pipe_ + post_pipe_);
+}
+
+// Convert a timeout to milliseconds for poll() and epoll_wait(). Rounds
+// up, so timers never fire early, unless the first timer's slack allows
+// rounding down.
+int driver_tamer::block_msec(int64_t blockns) const {
+    if (blockns <= 0) {
+        return int(blockns);
     }
+    int64_t ms = blockns / 1000000;
+    if (blockns % 1000000 != 0 && timers_.expiry_slack() < 1000) {
+        ++ms;
+    }
+    return int(std::min(ms, int64_t(1) << 30));
 }
 
-void driver_tamer::at_time(const timeval &expiry, event<> e, bool bg) {
+void driver_tamer::at_time(const timeval &expiry, event<> e, bool bg,
+                           const timeval &slack) {
     if (e) {
-        timers_.push(expiry, e.__release_simple(), bg);
+        timers_.push(tamerpriv::timeval_nsec(expiry), e.__release_simple(),
+                     bg, tamerpriv::timeval_nsec(slack));
     }
 }
 
@@ -408,13 +1605,18 @@ void driver_tamer::loop(loop_flags flags) {
     if (flags == loop_forever) {
         loop_state_ = true;
     }
+    bool sigs;
 #if DTAMER_EPOLL
-    xepoll_eventset epollnow;
     if (epollfd_ >= 0 && epoll_pid_ != getpid()) {
         close(epollfd_);
         epollfd_ = -1;
     }
 #endif
+#if DTAMER_URING
+    if (uring_.valid() && uring_fork_count_ != uring_fork_count) {
+        uring_recreate();
+    }
+#endif
 
  again:
     // process asap events
@@ -430,84 +1632,144 @@ void driver_tamer::loop(loop_flags flags) {
 
     // determine timeout
     timers_.cull();
-    int blockms;
-    if (!asap_.empty() || sig_any_active || has_unblocked()) {
-        blockms = 0;
+    int64_t blockns;
+    sigs = sig_pipe[0] >= 0 && owns_signals();
+    if (!asap_.empty() || has_posted() || (sigs && sig_any_active)
+        || has_unblocked()) {
+        blockns = 0;
     } else if (!timers_.empty()) {
-        timeval tnow = now();
-        if (!timercmp(&timers_.expiry(), &tnow, >)) {
-            blockms = 0;
+        uint64_t tnow = now_nsec();
+        if (timers_.due(tnow)) {
+            blockns = 0;
         } else {
             if (!timers_.has_foreground()
-                && pfds_.size() <= sig_pipe_
-                && sig_nforeground == 0) {
+                && fds_empty()
+                && nremote() == 0
+                && (!sigs || sig_nforeground == 0)) {
                 return; // no more foreground events
             }
             if (tamerpriv::time_type == time_virtual) {
-                blockms = 0;
+                blockns = 0;
             } else {
-                timeval to;
-                timersub(&timers_.expiry(), &tnow, &to);
-                blockms = to.tv_sec * 1000 + (to.tv_usec + 250) / 1000;
+                blockns = timers_.expiry() - tnow;
             }
         }
     } else {
-        if (pfds_.size() <= sig_pipe_
-            && sig_nforeground == 0) {
+        if (fds_empty()
+            && nremote() == 0
+            && (!sigs || sig_nforeground == 0)) {
             return; // no more foreground events
         }
-        blockms = -1;
+        blockns = -1;
     }
 
     // select!
     int eventcount = 0;
+    stats_before_wait();
+#if DTAMER_URING
+    if (uring_.valid() && uring_wait(blockns, sigs) == 0) {
+        goto after_poll;
+    }
+#endif
 #if DTAMER_EPOLL
     if (epollfd_ >= 0 || epoll_recreate()) {
-        if (!epoll_sig_pipe_ && sig_pipe[0] >= 0) {
+        if (!epoll_sig_pipe_ && sigs) {
             mark_epoll(sig_pipe[0], false, int(EPOLLIN | EPOLLRDHUP));
             epoll_sig_pipe_ = true;
         }
-        eventcount = epoll_wait(epollfd_, epollnow.data(), epollnow.size(),
-                                blockms);
+        if (!epoll_post_ && post_fd_[0] >= 0) {
+            mark_epoll(post_fd_[0], false, int(EPOLLIN));
+            epoll_post_ = true;
+        }
+#if HAVE_EPOLL_PWAIT2
+        if (__atomic_load_n(&epoll_pwait2_works, __ATOMIC_RELAXED)) {
+            timespec ts = nsec_timespec(blockns);
+            eventcount = epoll_pwait2(epollfd_, epollnow_.data(),
+                                      epollnow_.size(),
+                                      blockns < 0 ? nullptr : &ts, nullptr);
+            if (eventcount >= 0 || errno != ENOSYS) {
+                goto after_poll;
+            }
+            __atomic_store_n(&epoll_pwait2_works, false, __ATOMIC_RELAXED);
+        }
+#endif
+        eventcount = epoll_wait(epollfd_, epollnow_.data(), epollnow_.size(),
+                                block_msec(blockns));
         goto after_poll;
     }
 #endif
 
-    if (!sig_pipe_ && sig_pipe[0] >= 0) {
+    if (!sig_pipe_ && sigs) {
         pfds_.set_events(sig_pipe[0], int(POLLIN | POLLRDHUP));
         sig_pipe_ = true;
     }
-    if (pfds_.size() > sig_pipe_ || blockms != 0) {
-        eventcount = ::poll(pfds_.pollfds(), pfds_.size(), blockms);
+    if (!post_pipe_ && post_fd_[0] >= 0) {
+        pfds_.set_events(post_fd_[0], int(POLLIN));
+        post_pipe_ = true;
+    }
+    if (!fds_empty() || blockns != 0) {
+#if HAVE_PPOLL
+        timespec ts = nsec_timespec(blockns);
+        eventcount = ::ppoll(pfds_.pollfds(), pfds_.size(),
+                             blockns < 0 ? nullptr : &ts, nullptr);
+#else
+        eventcount = ::poll(pfds_.pollfds(), pfds_.size(),
+                            block_msec(blockns));
+#endif
         goto after_poll;
     }
 
 after_poll:
+    stats_after_wait();
     // process signals
     set_recent();
-    if (sig_any_active) {
+    if (sigs && sig_any_active) {
         dispatch_signals();
     }
 
     // process fd events
+#if DTAMER_URING
+    if (uring_.valid()) {
+        eventcount = uring_dispatch();
+        run_unblocked();
+        goto after_trigger_fd;
+    }
+#endif
 #if DTAMER_EPOLL
     if (epollfd_ >= 0) {
         for (int i = 0; i < eventcount; ++i) {
-            struct epoll_event& e = epollnow[i];
-            if (e.data.fd == sig_pipe[0]) {
+            struct epoll_event& e = epollnow_[i];
+            if (e.data.fd == sig_pipe[0] || e.data.fd == post_fd_[0]) {
+                continue;
+            } else if (epoll_et_) {
+                dispatch_epoll_et(e.data.fd, e.events);
                 continue;
             }
             auto& x = fds_[e.data.fd];
-            if (e.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
-                x.e[0].trigger(e.events & EPOLLIN ? 0 : outcome::closed);
+            int events = e.events;
+            if (events & EPOLLERR) {
+                if (x.e[3]) {
+                    x.e[3].trigger(0);
+                }
+                if (x.errqueue) {
+                    events &= ~EPOLLERR;
+                }
+            }
+            if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                x.e[0].trigger(events & EPOLLIN ? 0 : outcome::closed);
             }
-            if (e.events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
-                x.e[1].trigger(e.events & EPOLLOUT ? 0 : outcome::closed);
+            if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+                x.e[1].trigger(events & EPOLLOUT ? 0 : outcome::closed);
             }
-            if (e.events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
                 x.e[2].trigger(0);
             }
         }
+        if (eventcount == epollnow_.size()) {
+            // more events may be waiting; take more next time
+            ++epoll_saturations_;
+        }
+        epollnow_.adapt(eventcount);
         run_unblocked();
         goto after_trigger_fd;
     }
@@ -516,18 +1778,28 @@ after_poll:
     if (eventcount > 0) {
         auto endp = pfds_.end();
         for (auto p = pfds_.begin(); p != endp; ++p) {
-            if (p->revents == 0 || p->fd == sig_pipe[0]) {
+            if (p->revents == 0 || p->fd == sig_pipe[0]
+                || p->fd == post_fd_[0]) {
                 continue;
             }
             auto& x = fds_[p->fd];
             //fprintf(stderr, "%d: %s\n", p->fd, unparse_poll_events(p->revents).c_str());
-            if (p->revents & int(POLLIN | POLLRDHUP | POLLNVAL | POLLERR | POLLHUP)) {
-                x.e[0].trigger(p->revents & POLLIN ? 0 : outcome::closed);
+            int revents = p->revents;
+            if (revents & POLLERR) {
+                if (x.e[3]) {
+                    x.e[3].trigger(0);
+                }
+                if (x.errqueue) {
+                    revents &= ~POLLERR;
+                }
+            }
+            if (revents & int(POLLIN | POLLRDHUP | POLLNVAL | POLLERR | POLLHUP)) {
+                x.e[0].trigger(revents & POLLIN ? 0 : outcome::closed);
             }
-            if (p->revents & int(POLLOUT | POLLNVAL | POLLERR | POLLHUP)) {
-                x.e[1].trigger(p->revents & POLLOUT ? 0 : outcome::closed);
+            if (revents & int(POLLOUT | POLLNVAL | POLLERR | POLLHUP)) {
+                x.e[1].trigger(revents & POLLOUT ? 0 : outcome::closed);
             }
-            if (p->revents & int(POLLRDHUP | POLLNVAL | POLLERR | POLLHUP)) {
+            if (revents & int(POLLRDHUP | POLLNVAL | POLLERR | POLLHUP)) {
                 x.e[2].trigger(0);
             }
         }
@@ -540,14 +1812,19 @@ after_trigger_fd:
     if (!timers_.empty()
         && tamerpriv::time_type == time_virtual
         && eventcount == 0) {
-        tamerpriv::recent = timers_.expiry();
+        tamerpriv::set_recent_nsec(timers_.expiry());
     }
-    while (!timers_.empty()
-           && !timercmp(&timers_.expiry(), &recent(), >)) {
+    while (timers_.due(recent_nsec())) {
         timers_.pop_trigger();
     }
     run_unblocked();
 
+    // process events posted from other threads
+    if (has_posted()) {
+        run_posted();
+        run_unblocked();
+    }
+
     // process asap events
     while (!asap_.empty()) {
         asap_.pop_trigger();
@@ -567,22 +1844,39 @@ void driver_tamer::break_loop() {
 timeval driver_tamer::next_wake() const {
     struct timeval tv = { 0, 0 };
     if (!asap_.empty()
-        || sig_any_active
+        || has_posted()
+        || (sig_any_active && sig_driver == this)
         || has_unblocked()) {
         /* already zero */;
     } else if (timers_.empty()) {
         tv.tv_sec = -1;
     } else {
-        tv = timers_.expiry();
+        tv = tamerpriv::nsec_timeval(timers_.expiry());
     }
     return tv;
 }
 
+driver_stats driver_tamer::stats() const {
+    driver_stats s = driver::stats();
+    s.fds = pfds_.size() - sig_pipe_ - post_pipe_;
+    s.asap = asap_.size();
+    s.preblock = preblock_.size();
+    timers_.stats(s);
+#if DTAMER_EPOLL
+    s.poll_saturations = epoll_saturations_;
+#endif
+    return s;
+}
+
 void driver_tamer::clear() {
     auto pend = pfds_.end();
     for (auto p = pfds_.begin(); p != pend; ++p) {
         fds_[p->fd].clear();
     }
+#if DTAMER_URING
+    uring_io_clear(outcome::destroy);
+#endif
+    clear_posted();
     asap_.clear();
     preblock_.clear();
     timers_.clear();
@@ -592,7 +1886,20 @@ void driver_tamer::clear() {
 } // namespace
 
 driver* driver::make_tamer(int flags) {
-    return new driver_tamer(flags);
+    return new driver_tamer(flags & ~init_uring);
+}
+
+driver* driver::make_uring(int flags) {
+#if DTAMER_URING
+    driver_tamer* d = new driver_tamer(flags | init_uring);
+    if (d->open_uring()) {
+        return d;
+    }
+    delete d;
+#else
+    (void) flags;
+#endif
+    return nullptr;
 }
 
 } // namespace tamer
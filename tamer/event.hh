@@ -578,7 +578,7 @@ class preevent {
         }
     }
     inline void trigger(T0 v0) {
-        operator()(v0);
+        operator()(std::move(v0));
     }
     inline void tuple_trigger(const results_tuple_type& vs) {
         operator()(std::get<0>(vs));
@@ -754,7 +754,7 @@ inline void event<T0, T1, T2, T3>::operator()(T0 v0, T1 v1, T2 v2, T3 v3) {
  */
 template <typename T0, typename T1, typename T2, typename T3>
 inline void event<T0, T1, T2, T3>::trigger(T0 v0, T1 v1, T2 v2, T3 v3) {
-    operator()(v0, v1, v2, v3);
+    operator()(std::move(v0), std::move(v1), std::move(v2), std::move(v3));
 }
 
 /** @brief  Trigger event.
@@ -907,7 +907,7 @@ inline void event<T0, T1, T2>::operator()(T0 v0, T1 v1, T2 v2) {
 
 template <typename T0, typename T1, typename T2>
 inline void event<T0, T1, T2>::trigger(T0 v0, T1 v1, T2 v2) {
-    operator()(v0, v1, v2);
+    operator()(std::move(v0), std::move(v1), std::move(v2));
 }
 
 template <typename T0, typename T1, typename T2>
@@ -957,7 +957,7 @@ inline void event<T0, T1>::operator()(T0 v0, T1 v1) {
 
 template <typename T0, typename T1>
 inline void event<T0, T1>::trigger(T0 v0, T1 v1) {
-    operator()(v0, v1);
+    operator()(std::move(v0), std::move(v1));
 }
 
 template <typename T0, typename T1>
@@ -1006,7 +1006,7 @@ inline void event<T0>::operator()(T0 v0) {
 
 template <typename T0>
 inline void event<T0>::trigger(T0 v0) {
-    operator()(v0);
+    operator()(std::move(v0));
 }
 
 template <typename T0>
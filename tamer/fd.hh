@@ -20,20 +20,46 @@
 #include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
+#include <string.h>
 #include <netinet/in.h>
 #include <vector>
 #include <string>
+#include <memory>
 namespace tamer {
 
 /** @file <tamer/fd.hh>
  *  @brief  Event-based file descriptor wrapper class.
  */
 
+/** @brief  A datagram for fd::recvmmsg() and fd::sendmmsg().
+ *
+ *  @a addr holds the peer address; an @a addrlen of 0 means the socket's
+ *  connected peer. A nonzero @a segment_size means @a data holds several
+ *  UDP datagrams of that size (the last may be shorter), coalesced by
+ *  generic receive offload (GRO) or to be split by generic segmentation
+ *  offload (GSO). */
+struct datagram {
+    std::string data;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    size_t segment_size;
+
+    inline datagram();
+    inline datagram(std::string data, size_t segment_size = 0);
+    inline datagram(std::string data, const struct sockaddr* addr,
+                    socklen_t addrlen, size_t segment_size = 0);
+};
+
+class accept_control;
+
 class fd {
     struct fdimp;
 
   public:
     enum { default_backlog = 128 };
+    enum { zerocopy_threshold = 16384 };
+    enum { default_output_high_water = 65536 };
+    enum { default_datagram_size = 2048 };
 
     inline fd();
     explicit inline fd(int f);
@@ -98,15 +124,43 @@ class fd {
     inline void write_once(const struct iovec* iov, int iov_count, size_t& nwritten, event<> done);
     bool write_closed() const;
 
+    bool enqueue(std::string&& buf);
+    void flush(event<int> done);
+    inline void flush(event<> done);
+    size_t output_queued() const;
+    void set_output_high_water(size_t high_water);
+    void at_output_low_water(event<> e);
+
     void sendmsg(const void* buf, size_t size, int transfer_fd, event<int> done);
     inline void sendmsg(const void* buf, size_t size, event<int> done);
 
+    void recvmmsg(std::vector<datagram>& out, size_t max, size_t size, event<int> done);
+    inline void recvmmsg(std::vector<datagram>& out, size_t max, event<int> done);
+    void sendmmsg(const std::vector<datagram>& dgs, size_t* nsent_ptr, event<int> done);
+    inline void sendmmsg(const std::vector<datagram>& dgs, size_t& nsent, event<int> done);
+    inline void sendmmsg(const std::vector<datagram>& dgs, event<int> done);
+
+    void write_zerocopy(const void* buf, size_t size, size_t* nwritten_ptr, event<int> done);
+    inline void write_zerocopy(const void* buf, size_t size, size_t& nwritten, event<int> done);
+    inline void write_zerocopy(const void* buf, size_t size, event<int> done);
+
+    void sendfile(fd src, off_t offset, size_t size, size_t* nsent_ptr, event<int> done);
+    inline void sendfile(fd src, off_t offset, size_t size, size_t& nsent, event<int> done);
+    inline void sendfile(fd src, off_t offset, size_t size, event<int> done);
+    void splice(fd src, size_t size, size_t* nspliced_ptr, event<int> done);
+    inline void splice(fd src, size_t size, size_t& nspliced, event<int> done);
+
     void fstat(struct stat& stat, event<int> done);
 
     int listen(int backlog = default_backlog);
     int bind(const struct sockaddr* addr, socklen_t addrlen);
     void accept(struct sockaddr* addr, socklen_t* addrlen, event<fd> result);
     inline void accept(event<fd> result);
+    void accept_many(size_t max, std::vector<fd>& out, accept_control* control,
+                     event<int> done);
+    inline void accept_many(size_t max, std::vector<fd>& out, event<int> done);
+    inline void accept_many(size_t max, std::vector<fd>& out,
+                            accept_control& control, event<int> done);
     void connect(const struct sockaddr* addr, socklen_t addrlen,
                  event<int> done);
     inline int shutdown(int how);
@@ -123,6 +177,13 @@ class fd {
     inline int make_nonblocking();
 
   private:
+    void read_blocking(void* buf, size_t size, size_t pos, size_t* nread_ptr, event<int> done);
+    void write_blocking(const void* buf, size_t size, size_t pos, size_t* nwritten_ptr, event<int> done);
+    void drain_output();
+
+    struct zerocopy_state;
+    struct output_queue;
+
     struct fdimp {
         int fde_;
         int fdv_;
@@ -132,20 +193,28 @@ class fd {
 #if HAVE_TAMER_FDHELPER
         bool _is_file;
 #endif
+        signed char io_mode_;   // -1 unknown, 0 readiness, 1 completion
+        signed char zerocopy_;  // -1 unknown, 0 off, 1 SO_ZEROCOPY on
+        signed char gro_;       // -1 unknown, 0 off, 1 UDP_GRO on
         unsigned ref_count_;
         unsigned weak_count_;
+        zerocopy_state* zc_;
+        output_queue* oq_;
 
         fdimp(int fd)
             : fde_(fd < 0 ? fd : 0), fdv_(fd)
 #if HAVE_TAMER_FDHELPER
             , _is_file(false)
 #endif
-            , ref_count_(1), weak_count_(0) {
+            , io_mode_(-1), zerocopy_(-1), gro_(-1), ref_count_(1), weak_count_(0),
+              zc_(nullptr), oq_(nullptr) {
         }
+        ~fdimp();
         void deref() {
-            if (!--ref_count_)
-                close();
-            if (!ref_count_ && !weak_count_)
+            if (--ref_count_)
+                return;
+            close();
+            if (!weak_count_)
                 delete this;
         }
         void weak_deref() {
@@ -153,6 +222,20 @@ class fd {
                 delete this;
         }
         int close(int leave_error = -EBADF);
+        // true if reads and writes may be tried directly, with no helper
+        // process or completion-based I/O
+        bool direct_io() const {
+            return fde_ >= 0
+#if HAVE_TAMER_FDHELPER
+                && !_is_file
+#endif
+                && (io_mode_ == 0 || !driver::main->has_fd_io());
+        }
+        bool check_completion_io();
+        bool check_zerocopy();
+        bool check_gro();
+        int reap_zerocopy();
+        output_queue& output();
     };
 
     struct fdcloser {
@@ -170,17 +253,24 @@ class fd {
     };
 
     class closure__accept__P8sockaddrP9socklen_tQ2fd_; void accept(closure__accept__P8sockaddrP9socklen_tQ2fd_&);
+    class closure__accept_many__kRNSt6vectorI2fdEEP14accept_controlQi_; void accept_many(closure__accept_many__kRNSt6vectorI2fdEEP14accept_controlQi_&);
     class closure__connect__PK8sockaddr9socklen_tQi_; void connect(closure__connect__PK8sockaddr9socklen_tQi_&);
-    class closure__read__PvkPkQi_; void read(closure__read__PvkPkQi_&);
+    class closure__read_blocking__PvkkPkQi_; void read_blocking(closure__read_blocking__PvkkPkQi_&);
     class closure__read__P5ioveciPkQi_; void read(closure__read__P5ioveciPkQi_&);
     class closure__read_once__PvkRkQi_; void read_once(closure__read_once__PvkRkQi_ &);
     class closure__read_once__PK5ioveciRkQi_; void read_once(closure__read_once__PK5ioveciRkQi_&);
-    class closure__write__PKvkPkQi_; void write(closure__write__PKvkPkQi_ &);
+    class closure__write_blocking__PKvkkPkQi_; void write_blocking(closure__write_blocking__PKvkkPkQi_&);
     class closure__write__SsPkQi_; void write(closure__write__SsPkQi_ &);
     class closure__write__P5ioveciPkQi_; void write(closure__write__P5ioveciPkQi_&);
     class closure__write_once__PKvkRkQi_; void write_once(closure__write_once__PKvkRkQi_ &);
     class closure__write_once__PK5ioveciRkQi_; void write_once(closure__write_once__PK5ioveciRkQi_&);
     class closure__sendmsg__PKvkiQi_; void sendmsg(closure__sendmsg__PKvkiQi_ &);
+    class closure__recvmmsg__RNSt6vectorI8datagramEEkkQi_; void recvmmsg(closure__recvmmsg__RNSt6vectorI8datagramEEkkQi_&);
+    class closure__sendmmsg__RKNSt6vectorI8datagramEEPkQi_; void sendmmsg(closure__sendmmsg__RKNSt6vectorI8datagramEEPkQi_&);
+    class closure__drain_output; void drain_output(closure__drain_output&);
+    class closure__write_zerocopy__PKvkPkQi_; void write_zerocopy(closure__write_zerocopy__PKvkPkQi_&);
+    class closure__sendfile__2fd5off_tkPkQi_; void sendfile(closure__sendfile__2fd5off_tkPkQi_&);
+    class closure__splice__2fdkPkQi_; void splice(closure__splice__2fdkPkQi_&);
     class closure__open__PKci6mode_tQ2fd_; static void open(closure__open__PKci6mode_tQ2fd_ &);
 
     fdimp* _p;
@@ -211,6 +301,8 @@ class fdref {
     inline void release_write();
     inline ssize_t write(const void* buf, size_t size);
 
+    inline bool completion_io() const;
+
     inline void close();
     inline void close(int errcode);
 
@@ -225,8 +317,56 @@ class fdref {
     friend class fd;
 };
 
+/** @brief  Admission control for fd::accept_many().
+ *
+ *  An accept_control counts the connections fd::accept_many() accepted
+ *  through it that are still open, and refuses new ones while that count
+ *  reaches @a max_live or while file descriptor numbers come within @a
+ *  fd_headroom of fd::open_limit(). Refused connections stay in the
+ *  listen backlog until a counted connection closes, or until a periodic
+ *  retry finds room, so a connection storm cannot drive the process into
+ *  repeated EMFILE failures. An accept_control must outlive the
+ *  accept_many() calls that use it; the connections may outlive it. */
+class accept_control {
+  public:
+    enum { retry_msec = 250 };
+
+    explicit accept_control(size_t max_live = 0, int fd_headroom = 64);
+
+    inline size_t live() const;
+    inline size_t max_live() const;
+    inline void set_max_live(size_t max_live);
+    bool admit();
+    inline void at_release(event<> e);
+
+  private:
+    struct state {
+        size_t live = 0;
+        int next_fd = 0;    // estimated next descriptor number
+        event<> release;
+    };
+    std::shared_ptr<state> st_;
+    size_t max_live_;
+    int fd_headroom_;
+    int open_limit_;
+
+    void track(fd& f);
+    void exhausted();
+    void retry();
+
+    accept_control(const accept_control&) = delete;
+    accept_control& operator=(const accept_control&) = delete;
+
+    friend class fd;
+};
+
+enum tcp_listen_flags {
+    tcp_listen_reuseport = 1
+};
+
 inline fd tcp_listen(int port);
 fd tcp_listen(int port, int backlog);
+fd tcp_listen(int port, int backlog, int flags);
 inline void tcp_listen(int port, event<fd> result);
 void tcp_listen(int port, int backlog, event<fd> result);
 void tcp_connect(struct in_addr addr, int port, event<fd> result);
@@ -261,6 +401,46 @@ inline pid_t execvp(fd& in, fd& out, fd& err, const char* program,
                     const std::vector<const char*>& argv);
 
 
+/** @brief  Return the number of open connections counted by this control. */
+inline size_t accept_control::live() const {
+    return st_->live;
+}
+
+/** @brief  Return the maximum number of open connections, or 0. */
+inline size_t accept_control::max_live() const {
+    return max_live_;
+}
+
+/** @brief  Set the maximum number of open connections.
+ *
+ *  0 means no maximum. */
+inline void accept_control::set_max_live(size_t max_live) {
+    max_live_ = max_live;
+    st_->release.trigger();
+}
+
+/** @brief  Register @a e to trigger when a counted connection closes. */
+inline void accept_control::at_release(event<> e) {
+    st_->release += std::move(e);
+}
+
+inline datagram::datagram()
+    : addrlen(0), segment_size(0) {
+}
+
+/** @brief  Construct a datagram for a connected socket's peer. */
+inline datagram::datagram(std::string data, size_t segment_size)
+    : data(std::move(data)), addrlen(0), segment_size(segment_size) {
+}
+
+/** @brief  Construct a datagram for peer @a addr. */
+inline datagram::datagram(std::string data, const struct sockaddr* addr,
+                          socklen_t addrlen, size_t segment_size)
+    : data(std::move(data)), addrlen(addrlen), segment_size(segment_size) {
+    assert(addrlen <= sizeof(this->addr));
+    memcpy(&this->addr, addr, addrlen);
+}
+
 /** @brief  Construct an invalid file descriptor.
  *
  *  The resulting file descriptor has error() == -EBADF. This error code is
@@ -437,6 +617,23 @@ inline void fd::accept(event<fd> result) {
     accept(0, 0, result);
 }
 
+/** @brief  Accept a batch of new connections.
+ *  @param[out]  out   Accepted file descriptors are appended here.
+ *  @param       max   Maximum number of connections.
+ *  @param       done  Event triggered on completion.
+ *
+ *  Equivalent to accept_many(max, out, nullptr, done).
+ */
+inline void fd::accept_many(size_t max, std::vector<fd>& out, event<int> done) {
+    accept_many(max, out, (accept_control*) nullptr, done);
+}
+
+/** @overload */
+inline void fd::accept_many(size_t max, std::vector<fd>& out,
+                            accept_control& control, event<int> done) {
+    accept_many(max, out, &control, done);
+}
+
 /** @brief  Shut down a socket file descriptor for reading and/or writing.
     @param  how  SHUT_RD, SHUT_WR, or SHUT_RDWR */
 inline int fd::shutdown(int how) {
@@ -656,6 +853,85 @@ inline void fd::sendmsg(const void *buf, size_t size, event<int> done) {
     sendmsg(buf, size, -1, done);
 }
 
+/** @overload */
+inline void fd::flush(event<> done) {
+    flush(rebind<int>(done));
+}
+
+/** @brief  Receive datagrams of up to fd::default_datagram_size bytes.
+ *  @param[out]  out   Received datagrams are appended here.
+ *  @param       max   Maximum number of datagrams to receive.
+ *  @param       done  Event triggered on completion.
+ *
+ *  @sa recvmmsg(std::vector<datagram>&, size_t, size_t, event<int>)
+ */
+inline void fd::recvmmsg(std::vector<datagram>& out, size_t max, event<int> done) {
+    recvmmsg(out, max, default_datagram_size, done);
+}
+
+/** @brief  Send datagrams.
+ *  @param       dgs    Datagrams.
+ *  @param[out]  nsent  Number of datagrams sent.
+ *  @param       done   Event triggered on completion.
+ *
+ *  @sa sendmmsg(const std::vector<datagram>&, size_t*, event<int>)
+ */
+inline void fd::sendmmsg(const std::vector<datagram>& dgs, size_t& nsent, event<int> done) {
+    sendmmsg(dgs, &nsent, done);
+}
+
+/** @overload */
+inline void fd::sendmmsg(const std::vector<datagram>& dgs, event<int> done) {
+    sendmmsg(dgs, (size_t*) 0, done);
+}
+
+/** @brief  Write to file descriptor, avoiding a copy if possible.
+ *  @param       buf       Buffer.
+ *  @param       size      Buffer size.
+ *  @param[out]  nwritten  Number of characters written.
+ *  @param       done      Event triggered on completion.
+ *
+ *  @sa write_zerocopy(const void*, size_t, size_t*, event<int>)
+ */
+inline void fd::write_zerocopy(const void* buf, size_t size, size_t& nwritten, event<int> done) {
+    write_zerocopy(buf, size, &nwritten, done);
+}
+
+/** @overload */
+inline void fd::write_zerocopy(const void* buf, size_t size, event<int> done) {
+    write_zerocopy(buf, size, (size_t*) 0, done);
+}
+
+/** @brief  Send part of a file to this file descriptor.
+ *  @param       src     Source file.
+ *  @param       offset  Offset into @a src.
+ *  @param       size    Number of bytes to send.
+ *  @param[out]  nsent   Number of bytes sent.
+ *  @param       done    Event triggered on completion.
+ *
+ *  @sa sendfile(fd, off_t, size_t, size_t*, event<int>)
+ */
+inline void fd::sendfile(fd src, off_t offset, size_t size, size_t& nsent, event<int> done) {
+    sendfile(std::move(src), offset, size, &nsent, done);
+}
+
+/** @overload */
+inline void fd::sendfile(fd src, off_t offset, size_t size, event<int> done) {
+    sendfile(std::move(src), offset, size, 0, done);
+}
+
+/** @brief  Move data from @a src to this file descriptor.
+ *  @param       src        Source file descriptor.
+ *  @param       size       Maximum number of bytes to move.
+ *  @param[out]  nspliced   Number of bytes moved.
+ *  @param       done       Event triggered on completion.
+ *
+ *  @sa splice(fd, size_t, size_t*, event<int>)
+ */
+inline void fd::splice(fd src, size_t size, size_t& nspliced, event<int> done) {
+    splice(std::move(src), size, &nspliced, done);
+}
+
 /** @brief  Close file descriptor, marking it with an error.
  *  @param  errcode  Optional negative error code.
  *
@@ -678,7 +954,10 @@ inline void fd::error_close(int errcode) {
 /** @brief  Make this file descriptor use nonblocking I/O.
  */
 inline int fd::make_nonblocking() {
-    return make_nonblocking(_p ? _p->fde_ : -EBADF);
+    if (!_p || _p->fde_ < 0) {
+        return _p ? _p->fde_ : -EBADF;
+    }
+    return make_nonblocking(_p->fdv_);
 }
 
 /** @brief  Test whether two file descriptors refer to the same object.
@@ -804,6 +1083,14 @@ inline ssize_t fdref::write(const void* buf, size_t size) {
     }
 }
 
+/** @brief  Test whether operations on this file descriptor should use
+ *  the driver's completion-based I/O (see tamer::at_fd_io). */
+inline bool fdref::completion_io() const {
+    return imp_ && imp_->fde_ >= 0 && imp_->io_mode_ != 0
+        && driver::main->has_fd_io()
+        && (imp_->io_mode_ > 0 || imp_->check_completion_io());
+}
+
 inline void fdref::close() {
     if (imp_)
         imp_->close();
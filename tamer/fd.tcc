@@ -18,6 +18,7 @@
 #include <sys/ioctl.h>
 #include <sys/resource.h>
 #include <sys/un.h>
+#include <netinet/udp.h>
 #include <stdio.h>
 #include <signal.h>
 #include <unistd.h>
@@ -26,13 +27,28 @@
 #include <stdlib.h>
 #include <string.h>
 #include <poll.h>
+#if HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
+#if HAVE_LINUX_ERRQUEUE_H
+# include <linux/errqueue.h>
+#endif
 #include <tamer/tamer.hh>
 #if HAVE_TAMER_FDHELPER
 # include <tamer/fdh.hh>
 #endif
 #include <algorithm>
+#include <deque>
+#include <vector>
+#include <limits.h>
 extern char **environ;
 
+#if HAVE_LINUX_ERRQUEUE_H && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+# define TAMER_ZEROCOPY 1
+#else
+# define TAMER_ZEROCOPY 0
+#endif
+
 namespace tamer {
 
 /** @class fd tamer/fd.hh <tamer/fd.hh>
@@ -163,7 +179,7 @@ tamed static void fd::open(const char *filename, int flags, mode_t mode, event<f
     twait { _fdhm.open(filename, flags | O_NONBLOCK, mode, make_event(f)); }
     nfd = fd(f);
     nfd._p->_is_file = true;
-    done.trigger(nfd);
+    done.trigger(std::move(nfd));
 }
 #else
 /** @brief  Open a file descriptor.
@@ -184,7 +200,7 @@ void fd::open(const char *filename, int flags, mode_t mode, event<fd> done)
     fd nfd;
     int f = ::open(filename, flags | O_NONBLOCK, mode);
     nfd = fd(f == -1 ? -errno : f);
-    done.trigger(nfd);
+    done.trigger(std::move(nfd));
 }
 #endif
 
@@ -231,16 +247,293 @@ void fd::fstat(struct stat &stat_out, event<int> done)
     }
 }
 
-tamed void fd::read(void *buf, size_t size, size_t* nread_ptr, event<int> done)
+/** @brief  Decide whether this file descriptor can use completion I/O.
+ *
+ *  Completion-based operations are used only for sockets and pipes, where
+ *  data a canceled operation has already read can be handed to the next
+ *  read (see tamer::at_fd_io). */
+bool fd::fdimp::check_completion_io() {
+    struct stat st;
+    if (::fstat(fdv_, &st) == 0
+        && (S_ISSOCK(st.st_mode) || S_ISFIFO(st.st_mode))) {
+        io_mode_ = 1;
+    } else {
+        io_mode_ = 0;
+    }
+    return io_mode_ > 0;
+}
+
+// Completion-based operations are canceled when the caller's event
+// triggers early. A loop that issues many operations ties each one to the
+// caller's event through a single shared slot, rather than adding an
+// at_trigger hook to the caller's event per operation.
+namespace {
+struct io_canceller {
+    std::shared_ptr<event<>> slot;
+    void operator()() {
+        slot->trigger();
+    }
+};
+}
+
+template <typename E>
+static void tie_io_cancel(std::shared_ptr<event<>>& ioc, E& done,
+                          const event<int>& ioe) {
+    if (!ioc) {
+        ioc = std::make_shared<event<>>();
+        done.at_trigger(fun_event(io_canceller{ioc}));
+    }
+    *ioc = ioe.unblocker();
+}
+
+// MSG_ZEROCOPY sends on one socket are numbered consecutively from 0. The
+// kernel reports completed ranges of them on the socket's error queue,
+// usually but not always in order.
+struct fd::zerocopy_state {
+    uint32_t next_ = 0;     // number of the next send
+    uint32_t done_ = 0;     // every send before this one has completed
+    std::vector<std::pair<uint32_t, uint32_t>> early_;
+
+    bool done(uint32_t end) const {
+        return int32_t(done_ - end) >= 0;
+    }
+    void complete(uint32_t lo, uint32_t hi);
+};
+
+void fd::zerocopy_state::complete(uint32_t lo, uint32_t hi) {
+    if (lo != done_) {
+        early_.push_back(std::make_pair(lo, hi));
+        return;
+    }
+    done_ = hi + 1;
+    for (size_t i = 0; i != early_.size(); ) {
+        if (early_[i].first == done_) {
+            done_ = early_[i].second + 1;
+            early_[i] = early_.back();
+            early_.pop_back();
+            i = 0;
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Buffers handed to fd::enqueue(), written in order by drain_output().
+struct fd::output_queue {
+    std::deque<std::string> bufs;
+    size_t head_pos = 0;    // bytes of bufs.front() already written
+    size_t queued = 0;      // bytes not yet written
+    size_t high_water = default_output_high_water;
+    bool draining = false;
+    int error = 0;
+    event<int> flushed;
+    event<> low_water;
+
+    ssize_t writev(int f) const;
+    void consume(size_t amt);
+    void fail(int errcode);
+};
+
+#ifndef IOV_MAX
+# define IOV_MAX 1024
+#endif
+
+ssize_t fd::output_queue::writev(int f) const {
+    struct iovec iov[IOV_MAX];
+    int n = 0;
+    for (auto it = bufs.begin(); it != bufs.end() && n != IOV_MAX; ++it, ++n) {
+        size_t pos = n ? 0 : head_pos;
+        iov[n].iov_base = const_cast<char*>(it->data() + pos);
+        iov[n].iov_len = it->length() - pos;
+    }
+    return ::writev(f, iov, n);
+}
+
+void fd::output_queue::consume(size_t amt) {
+    queued -= amt;
+    while (amt != 0) {
+        size_t left = bufs.front().length() - head_pos;
+        if (amt < left) {
+            head_pos += amt;
+            break;
+        }
+        amt -= left;
+        bufs.pop_front();
+        head_pos = 0;
+    }
+    if (queued <= high_water / 2) {
+        low_water.trigger();
+    }
+}
+
+void fd::output_queue::fail(int errcode) {
+    error = errcode;
+    bufs.clear();
+    head_pos = queued = 0;
+    low_water.trigger();
+}
+
+fd::fdimp::~fdimp() {
+    delete zc_;
+    delete oq_;
+}
+
+fd::output_queue& fd::fdimp::output() {
+    if (!oq_) {
+        oq_ = new output_queue;
+    }
+    return *oq_;
+}
+
+/** @brief  Try to turn on SO_ZEROCOPY for this file descriptor.
+ *
+ *  Zero-copy sends need a TCP or UDP socket and a driver that can wait on
+ *  socket error queues. */
+bool fd::fdimp::check_zerocopy() {
+#if TAMER_ZEROCOPY
+    int one = 1;
+    if (fde_ >= 0
+        && driver::main->has_fd_errqueue()
+        && setsockopt(fdv_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) {
+        zerocopy_ = 1;
+        if (!zc_) {
+            zc_ = new zerocopy_state;
+        }
+        return true;
+    }
+#endif
+    zerocopy_ = 0;
+    return false;
+}
+
+/** @brief  Record whether this socket has UDP_GRO on. */
+bool fd::fdimp::check_gro() {
+#ifdef UDP_GRO
+    int gro = 0;
+    socklen_t len = sizeof(gro);
+    gro_ = getsockopt(fdv_, IPPROTO_UDP, UDP_GRO, &gro, &len) == 0 && gro;
+#else
+    gro_ = 0;
+#endif
+    return gro_ > 0;
+}
+
+/** @brief  Collect MSG_ZEROCOPY completions from the error queue.
+ *  @return  Number of completion messages, 0 if there were none, or
+ *  outcome::closed if there were none and a socket error is pending.
+ *
+ *  The pending error itself is left on the socket for reads and writes to
+ *  report.
+ *
+ *  If the kernel reports that it copied the data anyway, as it does for
+ *  loopback, later writes on this file descriptor skip MSG_ZEROCOPY. */
+int fd::fdimp::reap_zerocopy() {
+    int n = 0;
+#if TAMER_ZEROCOPY
+    while (fde_ >= 0) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (::recvmsg(fdv_, &msg, MSG_ERRQUEUE) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+             cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(cmsg->cmsg_level == SOL_IP
+                  && cmsg->cmsg_type == IP_RECVERR)
+                && !(cmsg->cmsg_level == SOL_IPV6
+                     && cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            struct sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cmsg), sizeof(ee));
+            if (ee.ee_origin == SO_EE_ORIGIN_ZEROCOPY && zc_) {
+                zc_->complete(ee.ee_info, ee.ee_data);
+                if (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    zerocopy_ = 0;
+                }
+                ++n;
+            }
+        }
+    }
+    if (n == 0 && fde_ >= 0) {
+        // with the error queue drained, POLLERR means a socket error;
+        // getsockopt(SO_ERROR) would clear it
+        struct pollfd pfd;
+        pfd.fd = fdv_;
+        pfd.events = 0;
+        if (::poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLERR)) {
+            n = outcome::closed;
+        }
+    }
+#endif
+    return n;
+}
+
+static inline ssize_t zerocopy_send(int fd, const void* buf, size_t size,
+                                    bool zerocopy) {
+#if TAMER_ZEROCOPY
+    return ::send(fd, buf, size, zerocopy ? MSG_ZEROCOPY : 0);
+#else
+    (void) zerocopy;
+    return ::send(fd, buf, size, 0);
+#endif
+}
+
+static inline ssize_t fd_io_result(int r) {
+    if (r < 0) {
+        errno = -r;
+        return -1;
+    } else {
+        return r;
+    }
+}
+
+// An uncontended read or write that completes with one system call needs
+// no closure. Otherwise the tamed *_blocking version continues from pos.
+void fd::read(void* buf, size_t size, size_t* nread_ptr, event<int> done)
+{
+    ssize_t amt = 0;
+    if (_p && done && _p->direct_io() && _p->rlock_.try_acquire()) {
+        amt = ::read(_p->fdv_, buf, size);
+        _p->rlock_.release();
+        if (amt == ssize_t(size) || amt == 0) {
+            if (nread_ptr) {
+                *nread_ptr = amt;
+            }
+            done.trigger(0);
+            return;
+        } else if (amt == -1 && errno != EAGAIN && errno != EWOULDBLOCK
+                   && errno != EINTR) {
+            if (nread_ptr) {
+                *nread_ptr = 0;
+            }
+            done.trigger(-errno);
+            return;
+        } else if (amt == -1) {
+            amt = 0;
+        }
+    }
+    read_blocking(buf, size, amt, nread_ptr, std::move(done));
+}
+
+tamed void fd::read_blocking(void* buf, size_t size, size_t pos,
+                             size_t* nread_ptr, event<int> done)
 {
     tamed {
-        size_t pos = 0;
         ssize_t amt;
+        int ioret;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     if (nread_ptr) {
-        *nread_ptr = 0;
+        *nread_ptr = pos;
     }
 
     if (!fi) {
@@ -258,7 +551,21 @@ tamed void fd::read(void *buf, size_t size, size_t* nread_ptr, event<int> done)
     twait { fi.acquire_read(make_event()); }
 
     while (pos != size && done && fi) {
-        amt = fi.read(static_cast<char*>(buf) + pos, size - pos);
+        if (fi.completion_io()) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                fd_io io(fd_io_read,
+                         static_cast<char*>(buf) + pos, size - pos);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            amt = fd_io_result(ioret);
+        } else {
+            amt = fi.read(static_cast<char*>(buf) + pos, size - pos);
+        }
         if (amt != 0 && amt != (ssize_t) -1) {
             pos += amt;
             if (nread_ptr) {
@@ -283,7 +590,9 @@ tamed void fd::read(struct iovec* iov, int iov_count, size_t* nread_ptr, event<i
         size_t pos = 0;
         size_t size = 0;
         ssize_t amt;
+        int ioret;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     if (nread_ptr) {
@@ -309,7 +618,20 @@ tamed void fd::read(struct iovec* iov, int iov_count, size_t* nread_ptr, event<i
     twait { fi.acquire_read(make_event()); }
 
     while (pos != size && done && fi) {
-        amt = ::readv(fi.fdnum(), iov, iov_count);
+        if (fi.completion_io()) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                fd_io io(fd_io_readv, iov, iov_count);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            amt = fd_io_result(ioret);
+        } else {
+            amt = ::readv(fi.fdnum(), iov, iov_count);
+        }
         if (amt != 0 && amt != (ssize_t) -1) {
             pos += amt;
             if (nread_ptr) {
@@ -342,7 +664,9 @@ tamed void fd::read_once(void* buf, size_t size, size_t& nread, event<int> done)
 {
     tamed {
         ssize_t amt;
+        int ioret;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     nread = 0;
@@ -355,7 +679,20 @@ tamed void fd::read_once(void* buf, size_t size, size_t& nread, event<int> done)
     twait { fi.acquire_read(make_event()); }
 
     while (done && fi) {
-        amt = fi.read(static_cast<char*>(buf), size);
+        if (fi.completion_io()) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                fd_io io(fd_io_read, buf, size);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            amt = fd_io_result(ioret);
+        } else {
+            amt = fi.read(static_cast<char*>(buf), size);
+        }
         if (amt != (ssize_t) -1) {
             nread = amt;
             break;
@@ -374,7 +711,9 @@ tamed void fd::read_once(const struct iovec* iov, int iov_count, size_t& nread,
 {
     tamed {
         ssize_t amt;
+        int ioret;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     nread = 0;
@@ -387,7 +726,21 @@ tamed void fd::read_once(const struct iovec* iov, int iov_count, size_t& nread,
     twait { fi.acquire_read(make_event()); }
 
     while (done && fi) {
-        amt = ::readv(fi.fdnum(), iov, iov_count);
+        if (fi.completion_io()) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                fd_io io(fd_io_readv,
+                         const_cast<struct iovec*>(iov), iov_count);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            amt = fd_io_result(ioret);
+        } else {
+            amt = ::readv(fi.fdnum(), iov, iov_count);
+        }
         if (amt != (ssize_t) -1) {
             nread = amt;
             break;
@@ -418,16 +771,43 @@ bool fd::write_closed() const {
     return r < 0 || (pfd[0].revents & (POLLERR | POLLHUP)) != 0;
 }
 
-tamed void fd::write(const void* buf, size_t size, size_t* nwritten_ptr,
-                     event<int> done) {
+void fd::write(const void* buf, size_t size, size_t* nwritten_ptr,
+               event<int> done) {
+    ssize_t amt = 0;
+    if (_p && done && _p->direct_io() && _p->wlock_.try_acquire()) {
+        amt = ::write(_p->fdv_, buf, size);
+        _p->wlock_.release();
+        if (amt == ssize_t(size)) {
+            if (nwritten_ptr) {
+                *nwritten_ptr = amt;
+            }
+            done.trigger(0);
+            return;
+        } else if (amt == -1 && errno != EAGAIN && errno != EWOULDBLOCK
+                   && errno != EINTR) {
+            if (nwritten_ptr) {
+                *nwritten_ptr = 0;
+            }
+            done.trigger(-errno);
+            return;
+        } else if (amt == -1) {
+            amt = 0;
+        }
+    }
+    write_blocking(buf, size, amt, nwritten_ptr, std::move(done));
+}
+
+tamed void fd::write_blocking(const void* buf, size_t size, size_t pos,
+                              size_t* nwritten_ptr, event<int> done) {
     tamed {
-        size_t pos = 0;
         ssize_t amt;
+        int ioret;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     if (nwritten_ptr) {
-        *nwritten_ptr = 0;
+        *nwritten_ptr = pos;
     }
 
     if (!fi) {
@@ -445,7 +825,21 @@ tamed void fd::write(const void* buf, size_t size, size_t* nwritten_ptr,
     twait { fi.acquire_write(make_event()); }
 
     while (pos != size && done && fi) {
-        amt = fi.write(static_cast<const char*>(buf) + pos, size - pos);
+        if (fi.completion_io()) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                char* wbuf = const_cast<char*>(static_cast<const char*>(buf));
+                fd_io io(fd_io_write, wbuf + pos, size - pos);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            amt = fd_io_result(ioret);
+        } else {
+            amt = fi.write(static_cast<const char*>(buf) + pos, size - pos);
+        }
         if (amt != 0 && amt != (ssize_t) -1) {
             pos += amt;
             if (nwritten_ptr)
@@ -478,7 +872,9 @@ tamed void fd::write(struct iovec* iov, int iov_count, size_t* nwritten_ptr,
         size_t pos = 0;
         size_t size = 0;
         ssize_t amt;
+        int ioret;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     if (nwritten_ptr) {
@@ -504,7 +900,20 @@ tamed void fd::write(struct iovec* iov, int iov_count, size_t* nwritten_ptr,
     twait { fi.acquire_write(make_event()); }
 
     while (pos != size && done && fi) {
-        amt = ::writev(fi.fdnum(), iov, iov_count);
+        if (fi.completion_io()) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                fd_io io(fd_io_writev, iov, iov_count);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            amt = fd_io_result(ioret);
+        } else {
+            amt = ::writev(fi.fdnum(), iov, iov_count);
+        }
         if (amt != 0 && amt != (ssize_t) -1) {
             pos += amt;
             if (nwritten_ptr) {
@@ -533,6 +942,135 @@ tamed void fd::write(struct iovec* iov, int iov_count, size_t* nwritten_ptr,
     done.trigger(pos == size || fi ? 0 : -ECANCELED);
 }
 
+/** @brief  Add data to this file descriptor's output queue.
+ *  @param  buf  Data, moved into the queue.
+ *  @return  True if the queue is below its high-water mark and writing
+ *           has not failed.
+ *
+ *  Queued data is written in order, without copying, in the background.
+ *  Pieces queued during the same turn of the event loop are coalesced,
+ *  up to @c IOV_MAX per @c writev() system call, so code that produces
+ *  headers, body chunks, and trailers separately pays for one system call
+ *  rather than one per piece. Use flush() to learn when the data has been
+ *  written.
+ *
+ *  A false return value signals backpressure: the queue holds at least
+ *  the high-water mark's worth of data (see set_output_high_water()).
+ *  Data is still accepted, but producers should wait for
+ *  at_output_low_water() before queueing more. Once a write has failed,
+ *  enqueue() discards @a buf and always returns false.
+ *
+ *  The queue drains under the write lock. Data queued while a drain is
+ *  in progress joins that drain, so it may overtake write() calls made
+ *  earlier; don't mix the two styles on one file descriptor. Closing
+ *  the file descriptor discards unwritten data, and after a write error
+ *  further queued data is discarded too.
+ */
+bool fd::enqueue(std::string&& buf) {
+    if (!*this) {
+        return false;
+    }
+    output_queue& oq = _p->output();
+    if (!oq.error && !buf.empty()) {
+        oq.queued += buf.length();
+        oq.bufs.push_back(std::move(buf));
+        if (!oq.draining) {
+            oq.draining = true;
+            drain_output();
+        }
+    }
+    return !oq.error && oq.queued < oq.high_water;
+}
+
+/** @brief  Wait for the output queue to drain.
+ *  @param  done  Event triggered on completion.
+ *
+ *  @a done is triggered with 0 once every byte queued with enqueue() has
+ *  been written, or with a negative error code if writing failed or the
+ *  file descriptor was closed first. */
+void fd::flush(event<int> done) {
+    if (!*this) {
+        done.trigger(error());
+    } else if (!_p->oq_ || !_p->oq_->draining) {
+        done.trigger(_p->oq_ ? _p->oq_->error : 0);
+    } else {
+        _p->oq_->flushed += std::move(done);
+    }
+}
+
+/** @brief  Return the number of bytes queued by enqueue() but not yet
+ *  written. */
+size_t fd::output_queued() const {
+    return *this && _p->oq_ ? _p->oq_->queued : 0;
+}
+
+/** @brief  Set the output queue's high-water mark.
+ *  @param  high_water  Mark in bytes.
+ *
+ *  enqueue() returns false while at least @a high_water bytes are queued.
+ *  The low-water mark is half the high-water mark. The default is
+ *  fd::default_output_high_water. */
+void fd::set_output_high_water(size_t high_water) {
+    if (*this) {
+        output_queue& oq = _p->output();
+        oq.high_water = high_water;
+        if (oq.queued <= high_water / 2) {
+            oq.low_water.trigger();
+        }
+    }
+}
+
+/** @brief  Register event for output queue space.
+ *  @param  e  Event.
+ *
+ *  Triggers @a e once the output queue holds no more than half its
+ *  high-water mark, which may be immediately. Also triggers @a e when
+ *  queued data is discarded because of an error or close. */
+void fd::at_output_low_water(event<> e) {
+    if (!*this || !_p->oq_ || _p->oq_->queued <= _p->oq_->high_water / 2) {
+        e.trigger();
+    } else {
+        _p->oq_->low_water += std::move(e);
+    }
+}
+
+tamed void fd::drain_output() {
+    tamed {
+        ssize_t amt;
+        int ret = 0;
+        fdref fi(*this, fdref::weak);
+        output_queue* oq = &fi.imp_->output();
+    }
+
+    twait { fi.acquire_write(make_event()); }
+    // collect everything queued during this turn
+    twait { tamer::at_asap(make_event()); }
+
+    while (oq->queued != 0 && fi) {
+        amt = oq->writev(fi.fdnum());
+        if (amt != 0 && amt != (ssize_t) -1) {
+            oq->consume(amt);
+        } else if (amt == 0) {
+            ret = -EPIPE;
+            break;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            twait { tamer::at_fd_write(fi.fdnum(), make_event()); }
+        } else if (errno != EINTR) {
+            ret = -errno;
+            break;
+        }
+    }
+
+    if (ret == 0 && !fi) {
+        ret = -ECANCELED;
+    }
+    if (ret != 0) {
+        oq->fail(ret);
+    }
+    oq->draining = false;
+    oq->flushed.trigger(ret);
+}
+
 /** @brief  Write once to file descriptor.
  *  @param       buf       Buffer.
  *  @param       size      Buffer size.
@@ -552,7 +1090,9 @@ tamed void fd::write_once(const void *buf, size_t size, size_t &nwritten, event<
 {
     tamed {
         ssize_t amt;
+        int ioret;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     nwritten = 0;
@@ -565,7 +1105,20 @@ tamed void fd::write_once(const void *buf, size_t size, size_t &nwritten, event<
     twait { fi.acquire_write(make_event()); }
 
     while (done && fi) {
-        amt = fi.write(static_cast<const char*>(buf), size);
+        if (fi.completion_io()) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                fd_io io(fd_io_write, const_cast<void*>(buf), size);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            amt = fd_io_result(ioret);
+        } else {
+            amt = fi.write(static_cast<const char*>(buf), size);
+        }
         if (amt != (ssize_t) -1) {
             nwritten = amt;
             break;
@@ -600,7 +1153,9 @@ tamed void fd::write_once(const struct iovec* iov, int iov_count, size_t& nwritt
 {
     tamed {
         ssize_t amt;
+        int ioret;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     nwritten = 0;
@@ -613,7 +1168,21 @@ tamed void fd::write_once(const struct iovec* iov, int iov_count, size_t& nwritt
     twait { fi.acquire_write(make_event()); }
 
     while (done && fi) {
-        amt = ::writev(fi.fdnum(), iov, iov_count);
+        if (fi.completion_io()) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                fd_io io(fd_io_writev,
+                         const_cast<struct iovec*>(iov), iov_count);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            amt = fd_io_result(ioret);
+        } else {
+            amt = ::writev(fi.fdnum(), iov, iov_count);
+        }
         if (amt != (ssize_t) -1) {
             nwritten = amt;
             break;
@@ -706,6 +1275,533 @@ tamed void fd::sendmsg(const void *buf, size_t size, int transfer_fd,
     done.trigger(fi ? 0 : -ECANCELED);
 }
 
+// Datagrams move in batches of at most datagram_batch per system call.
+// Received datagrams land in a per-thread scratch area, sized by the
+// caller (or datagram_gro_space, enough for a GRO-coalesced batch, if the
+// socket has UDP_GRO on), and are then copied out at their real size.
+enum {
+    datagram_batch = 64,
+    datagram_gro_space = 65536,
+    datagram_control_space = 64
+};
+
+#if !HAVE_RECVMMSG && !HAVE_SENDMMSG
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned msg_len;
+};
+#endif
+
+static inline size_t datagram_gro_size(struct msghdr* msg) {
+#ifdef UDP_GRO
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+         cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+            return size;
+        }
+    }
+#else
+    (void) msg;
+#endif
+    return 0;
+}
+
+static int receive_datagrams(int f, std::vector<datagram>& out, size_t max,
+                             size_t size) {
+    static thread_local std::vector<char> space;
+    struct mmsghdr msgs[datagram_batch];
+    struct iovec iov[datagram_batch];
+    struct sockaddr_storage addrs[datagram_batch];
+    int n;
+
+    max = std::min(max, size_t(datagram_batch));
+    if (space.size() < max * (size + datagram_control_space)) {
+        space.resize(max * (size + datagram_control_space));
+    }
+    for (size_t i = 0; i != max; ++i) {
+        char* buf = &space[i * (size + datagram_control_space)];
+        iov[i].iov_base = buf;
+        iov[i].iov_len = size;
+        struct msghdr& msg = msgs[i].msg_hdr;
+        msg.msg_name = &addrs[i];
+        msg.msg_namelen = sizeof(struct sockaddr_storage);
+        msg.msg_iov = &iov[i];
+        msg.msg_iovlen = 1;
+        msg.msg_control = buf + size;
+        msg.msg_controllen = datagram_control_space;
+        msg.msg_flags = 0;
+        msgs[i].msg_len = 0;
+    }
+
+#if HAVE_RECVMMSG
+    n = ::recvmmsg(f, msgs, max, MSG_DONTWAIT, nullptr);
+#else
+    for (n = 0; size_t(n) != max; ++n) {
+        ssize_t r = ::recvmsg(f, &msgs[n].msg_hdr, MSG_DONTWAIT);
+        if (r == (ssize_t) -1) {
+            break;
+        }
+        msgs[n].msg_len = r;
+    }
+    n = n ? n : -1;
+#endif
+
+    if (n < 0) {
+        return -errno;
+    }
+    out.reserve(out.size() + n);
+    for (int i = 0; i != n; ++i) {
+        out.emplace_back(std::string(static_cast<char*>(iov[i].iov_base),
+                                     msgs[i].msg_len),
+                         (struct sockaddr*) &addrs[i],
+                         msgs[i].msg_hdr.msg_namelen,
+                         datagram_gro_size(&msgs[i].msg_hdr));
+    }
+    return n;
+}
+
+static int send_datagrams(int f, const datagram* dgs, size_t n) {
+    struct mmsghdr msgs[datagram_batch];
+    struct iovec iov[datagram_batch];
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } control[datagram_batch];
+    int r;
+
+    n = std::min(n, size_t(datagram_batch));
+    for (size_t i = 0; i != n; ++i) {
+        iov[i].iov_base = const_cast<char*>(dgs[i].data.data());
+        iov[i].iov_len = dgs[i].data.length();
+        struct msghdr& msg = msgs[i].msg_hdr;
+        msg.msg_name = dgs[i].addrlen ? (void*) &dgs[i].addr : nullptr;
+        msg.msg_namelen = dgs[i].addrlen;
+        msg.msg_iov = &iov[i];
+        msg.msg_iovlen = 1;
+        msg.msg_control = nullptr;
+        msg.msg_controllen = 0;
+        msg.msg_flags = 0;
+        if (dgs[i].segment_size) {
+#ifdef UDP_SEGMENT
+            msg.msg_control = control[i].buf;
+            msg.msg_controllen = sizeof(control[i].buf);
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t size = dgs[i].segment_size;
+            memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+#else
+            if (i == 0) {
+                return -EOPNOTSUPP;
+            }
+            n = i;
+            break;
+#endif
+        }
+    }
+
+#if HAVE_SENDMMSG
+    r = ::sendmmsg(f, msgs, n, MSG_DONTWAIT);
+#else
+    for (r = 0; size_t(r) != n; ++r) {
+        if (::sendmsg(f, &msgs[r].msg_hdr, MSG_DONTWAIT) == (ssize_t) -1) {
+            break;
+        }
+    }
+    r = r ? r : -1;
+#endif
+    return r < 0 ? -errno : r;
+}
+
+/** @brief  Receive datagrams.
+ *  @param[out]  out   Received datagrams are appended here.
+ *  @param       max   Maximum number of datagrams to receive.
+ *  @param       size  Maximum datagram size.
+ *  @param       done  Event triggered on completion.
+ *
+ *  Waits until the socket has at least one datagram, then appends as many
+ *  as are waiting, up to @a max, to @a out. Where the system supports @c
+ *  recvmmsg(), one system call fetches up to 64 of them. @a done is
+ *  triggered with 0 on success or a negative error code. If the socket
+ *  has UDP_GRO enabled, a received datagram may hold several coalesced
+ *  datagrams; its segment_size is then nonzero.
+ *
+ *  Datagrams longer than @a size are truncated to @a size bytes. On
+ *  sockets with UDP_GRO enabled, @a size is raised to 64KB so coalesced
+ *  datagrams fit. The UDP_GRO setting is read on the first call, so enable
+ *  it before then. Each thread keeps a scratch area of about @a max times
+ *  @a size bytes, so prefer a @a size no larger than needed.
+ */
+tamed void fd::recvmmsg(std::vector<datagram>& out, size_t max, size_t size,
+                        event<int> done) {
+    tamed {
+        int n;
+        fdref fi(*this, fdref::weak);
+    }
+
+    if (!fi) {
+        done.trigger(-EBADF);
+        return;
+    }
+
+    if (fi.imp_->gro_ < 0 ? fi.imp_->check_gro() : fi.imp_->gro_ > 0) {
+        size = std::max(size, size_t(datagram_gro_space));
+    }
+
+    twait { fi.acquire_read(make_event()); }
+
+    while (max != 0 && done && fi) {
+        n = receive_datagrams(fi.fdnum(), out, max, size);
+        if (n >= 0) {
+            break;
+        } else if (n == -EAGAIN || n == -EWOULDBLOCK) {
+            twait { tamer::at_fd_read(fi.fdnum(), make_event()); }
+        } else if (n != -EINTR) {
+            done.trigger(n);
+            break;
+        }
+    }
+
+    done.trigger(fi ? 0 : -ECANCELED);
+}
+
+/** @brief  Send datagrams.
+ *  @param       dgs        Datagrams.
+ *  @param[out]  nsent_ptr  Number of datagrams sent (may be null).
+ *  @param       done       Event triggered on completion.
+ *
+ *  Sends every datagram in @a dgs, in order. Where the system supports @c
+ *  sendmmsg(), one system call sends up to 64 of them. A datagram with a
+ *  nonzero segment_size is split by the kernel into datagrams of that
+ *  size (UDP GSO); where the system lacks GSO, such datagrams fail with
+ *  -EOPNOTSUPP. @a done is triggered with 0 on success or a negative
+ *  error code, in which case @a *nsent_ptr says how many datagrams made
+ *  it. @a dgs must remain valid until @a done is triggered.
+ */
+tamed void fd::sendmmsg(const std::vector<datagram>& dgs, size_t* nsent_ptr,
+                        event<int> done) {
+    tamed {
+        size_t pos = 0;
+        int n;
+        fdref fi(*this, fdref::weak);
+    }
+
+    if (nsent_ptr) {
+        *nsent_ptr = 0;
+    }
+
+    if (!fi) {
+        done.trigger(-EBADF);
+        return;
+    }
+
+    twait { fi.acquire_write(make_event()); }
+
+    while (pos != dgs.size() && done && fi) {
+        n = send_datagrams(fi.fdnum(), dgs.data() + pos, dgs.size() - pos);
+        if (n >= 0) {
+            pos += n;
+            if (nsent_ptr) {
+                *nsent_ptr = pos;
+            }
+        } else if (n == -EAGAIN || n == -EWOULDBLOCK) {
+            twait { tamer::at_fd_write(fi.fdnum(), make_event()); }
+        } else if (n != -EINTR) {
+            done.trigger(n);
+            break;
+        }
+    }
+
+    done.trigger(pos == dgs.size() || fi ? 0 : -ECANCELED);
+}
+
+/** @brief  Write to file descriptor, avoiding a copy if possible.
+ *  @param       buf           Buffer.
+ *  @param       size          Buffer size.
+ *  @param[out]  nwritten_ptr  Number of characters written (may be null).
+ *  @param       done          Event triggered on completion.
+ *
+ *  Like write(), but large writes to TCP and UDP sockets use MSG_ZEROCOPY:
+ *  the kernel transmits straight from @a buf instead of copying it into
+ *  socket buffers. @a done is triggered only after the kernel reports, on
+ *  the socket's error queue, that it no longer needs @a buf, so @a buf
+ *  must stay unchanged until then. Writes smaller than
+ *  fd::zerocopy_threshold, writes to other file descriptors, and writes
+ *  under drivers without driver::has_fd_errqueue() behave like write().
+ *
+ *  Zero-copy sends pay for page pinning and completion notifications, so
+ *  they only help for writes of tens of kilobytes or more. If the kernel
+ *  reports it had to copy the data anyway, or refuses to pin more pages
+ *  while none are outstanding, later calls on this file descriptor fall
+ *  back to write().
+ *
+ *  Triggering @a done early stops further sends but does not release
+ *  @a buf: the kernel may still read pages it was handed.
+ */
+tamed void fd::write_zerocopy(const void* buf, size_t size,
+                              size_t* nwritten_ptr, event<int> done) {
+    tamed {
+        size_t pos = 0;
+        ssize_t amt;
+        int ret = 0;
+        bool zerocopy;
+        uint32_t end;
+        fdref fi(*this, fdref::weak);
+    }
+
+    if (!fi
+        || size < zerocopy_threshold
+        || (fi.imp_->zerocopy_ < 0 ? !fi.imp_->check_zerocopy()
+            : fi.imp_->zerocopy_ == 0)) {
+        write(buf, size, nwritten_ptr, done);
+        return;
+    }
+
+    if (nwritten_ptr) {
+        *nwritten_ptr = 0;
+    }
+
+    twait { fi.acquire_write(make_event()); }
+
+    while (pos != size && done && fi) {
+        zerocopy = fi.imp_->zerocopy_ > 0;
+        amt = zerocopy_send(fi.fdnum(), static_cast<const char*>(buf) + pos,
+                            size - pos, zerocopy);
+        if (amt != 0 && amt != (ssize_t) -1) {
+            if (zerocopy) {
+                ++fi.imp_->zc_->next_;
+            }
+            pos += amt;
+            if (nwritten_ptr)
+                *nwritten_ptr = pos;
+        } else if (amt == 0) {
+            break;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // completions must not pile up while the socket is full
+            if ((ret = fi.imp_->reap_zerocopy()) < 0) {
+                break;
+            } else if (ret == 0) {
+                twait {
+                    event<> e = make_event();
+                    tamer::at_fd_write(fi.fdnum(), e);
+                    tamer::at_fd_errqueue(fi.fdnum(), e);
+                }
+            }
+            ret = 0;
+        } else if (errno == ENOBUFS && zerocopy) {
+            // too many pinned pages: wait for some to be released
+            if ((ret = fi.imp_->reap_zerocopy()) < 0) {
+                break;
+            } else if (fi.imp_->zc_->done(fi.imp_->zc_->next_)) {
+                fi.imp_->zerocopy_ = 0;
+            } else if (ret == 0) {
+                twait { tamer::at_fd_errqueue(fi.fdnum(), make_event()); }
+            }
+            ret = 0;
+        } else if (errno != EINTR) {
+            ret = -errno;
+            break;
+        }
+    }
+
+    // let later writes proceed while this one's pages drain
+    end = fi.imp_->zc_->next_;
+    fi.release_write();
+
+    while (ret == 0 && fi && !fi.imp_->zc_->done(end)) {
+        if ((ret = fi.imp_->reap_zerocopy()) == 0) {
+            twait { tamer::at_fd_errqueue(fi.fdnum(), make_event()); }
+        } else if (ret > 0) {
+            ret = 0;
+        }
+    }
+
+    done.trigger(ret ? ret : (pos == size || fi ? 0 : -ECANCELED));
+}
+
+/** @brief  Send part of a file to this file descriptor.
+ *  @param       src        Source file.
+ *  @param       offset     Offset into @a src.
+ *  @param       size       Number of bytes to send.
+ *  @param[out]  nsent_ptr  Number of bytes sent (may be null).
+ *  @param       done       Event triggered on completion.
+ *
+ *  Sends @a size bytes of @a src, starting at @a offset, without copying
+ *  them through user space where the system supports @c sendfile(). The
+ *  file position of @a src is not changed. @a done is triggered with 0 on
+ *  success or end-of-file, or a negative error code. @a *nsent_ptr is kept
+ *  up to date as the transfer progresses. Like write(), sendfile() waits
+ *  for earlier writes to this file descriptor to complete.
+ */
+tamed void fd::sendfile(fd src, off_t offset, size_t size, size_t* nsent_ptr,
+                        event<int> done) {
+    tamed {
+        size_t pos = 0;
+        ssize_t amt;
+        size_t bpos = 0, blen = 0;
+        std::string buf;
+        fdref fi(*this, fdref::weak);
+        fdref si(src, fdref::weak);
+    }
+
+    if (nsent_ptr) {
+        *nsent_ptr = 0;
+    }
+
+    if (!fi || !si) {
+        done.trigger(-EBADF);
+        return;
+    }
+
+    twait { fi.acquire_write(make_event()); }
+
+    while (pos != size && done && fi && si) {
+#if HAVE_SYS_SENDFILE_H
+        {
+            off_t off = offset + pos;
+            amt = ::sendfile(fi.fdnum(), si.fdnum(), &off, size - pos);
+        }
+#else
+        if (bpos == blen) {
+            buf.resize(65536);
+            amt = ::pread(si.fdnum(), &buf[0],
+                          std::min(size - pos, buf.size()), offset + pos);
+            if (amt > 0) {
+                bpos = 0;
+                blen = amt;
+            }
+        }
+        if (bpos != blen) {
+            amt = fi.write(&buf[bpos], blen - bpos);
+            if (amt > 0) {
+                bpos += amt;
+            }
+        }
+#endif
+        if (amt != 0 && amt != (ssize_t) -1) {
+            pos += amt;
+            if (nsent_ptr) {
+                *nsent_ptr = pos;
+            }
+        } else if (amt == 0) {
+            break;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            twait { tamer::at_fd_write(fi.fdnum(), make_event()); }
+        } else if (errno != EINTR) {
+            done.trigger(-errno);
+            break;
+        }
+    }
+
+    done.trigger(pos == size || (fi && si) ? 0 : -ECANCELED);
+}
+
+/** @brief  Move data from @a src to this file descriptor.
+ *  @param       src           Source file descriptor.
+ *  @param       size          Maximum number of bytes to move.
+ *  @param[out]  nspliced_ptr  Number of bytes moved (may be null).
+ *  @param       done          Event triggered on completion.
+ *
+ *  Reads from @a src and writes to this file descriptor until @a size bytes
+ *  have moved or @a src reaches end-of-file. Pass <code>(size_t) -1</code>
+ *  to move everything. Where the system supports @c splice(), the data
+ *  passes through a kernel pipe and is never copied to user space, so
+ *  neither file descriptor needs to be a pipe; this suits socket-to-socket
+ *  proxying. @a done is triggered with 0 on success or end-of-file, or a
+ *  negative error code. @a *nspliced_ptr counts bytes written to this file
+ *  descriptor. splice() holds this file descriptor's write lock and @a
+ *  src's read lock throughout.
+ */
+tamed void fd::splice(fd src, size_t size, size_t* nspliced_ptr,
+                      event<int> done) {
+    tamed {
+        size_t pos = 0;
+        size_t pending = 0;
+        ssize_t amt;
+        bool reading;
+        fd prfd, pwfd;
+        size_t bpos = 0;
+        std::string buf;
+        fdref fi(*this, fdref::weak);
+        fdref si(src, fdref::weak);
+    }
+
+    if (nspliced_ptr) {
+        *nspliced_ptr = 0;
+    }
+
+    if (!fi || !si) {
+        done.trigger(-EBADF);
+        return;
+    }
+
+#if HAVE_SPLICE
+    if (fd::pipe(prfd, pwfd) < 0) {
+        done.trigger(prfd.error());
+        return;
+    }
+#else
+    buf.resize(65536);
+#endif
+
+    twait {
+        fi.acquire_write(make_event());
+        si.acquire_read(make_event());
+    }
+
+    // move data into the pipe (or buffer) when it is empty, then out of it
+    while (pos != size && done && fi && si) {
+        reading = pending == 0;
+#if HAVE_SPLICE
+        if (reading) {
+            amt = ::splice(si.fdnum(), NULL, pwfd.fdnum(), NULL,
+                           std::min(size - pos, (size_t) 65536),
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        } else {
+            amt = ::splice(prfd.fdnum(), NULL, fi.fdnum(), NULL, pending,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        }
+#else
+        if (reading) {
+            amt = si.read(&buf[0], std::min(size - pos, (size_t) 65536));
+            bpos = 0;
+        } else {
+            amt = fi.write(&buf[bpos], pending);
+            if (amt > 0) {
+                bpos += amt;
+            }
+        }
+#endif
+        if (amt != 0 && amt != (ssize_t) -1) {
+            if (reading) {
+                pending = amt;
+            } else {
+                pending -= amt;
+                pos += amt;
+                if (nspliced_ptr) {
+                    *nspliced_ptr = pos;
+                }
+            }
+        } else if (amt == 0) {
+            break;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (reading) {
+                twait { tamer::at_fd_read(si.fdnum(), make_event()); }
+            } else {
+                twait { tamer::at_fd_write(fi.fdnum(), make_event()); }
+            }
+        } else if (errno != EINTR) {
+            done.trigger(-errno);
+            break;
+        }
+    }
+
+    done.trigger(pos == size || (fi && si) ? 0 : -ECANCELED);
+}
+
 /** @brief  Create a socket file descriptor.
  *  @param  domain    Socket domain.
  *  @param  type      Socket type.
@@ -771,7 +1867,10 @@ tamed void fd::accept(struct sockaddr *addr_out, socklen_t *addrlen_out,
                       event<fd> done) {
     tamed {
         int f = -ECANCELED;
+        int ioret;
+        bool completion;
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     if (!fi) {
@@ -782,9 +1881,26 @@ tamed void fd::accept(struct sockaddr *addr_out, socklen_t *addrlen_out,
     twait { fi.acquire_read(make_event()); }
 
     while (done && fi) {
-        f = ::accept(fi.fdnum(), addr_out, addrlen_out);
+        completion = fi.completion_io();
+        if (completion) {
+            ioret = -ECANCELED;
+            twait {
+                event<int> ioe = make_event(ioret);
+                tie_io_cancel(ioc, done, ioe);
+                fd_io io(fd_io_accept, addr_out, 0, addrlen_out);
+                if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                    ioe.trigger(-EAGAIN);
+                }
+            }
+            f = fd_io_result(ioret);
+        } else {
+            f = ::accept(fi.fdnum(), addr_out, addrlen_out);
+        }
         if (f >= 0) {
-            make_nonblocking(f);
+            // completion accepts are created with SOCK_NONBLOCK
+            if (!completion) {
+                make_nonblocking(f);
+            }
             break;
         } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
             twait { tamer::at_fd_read(fi.fdnum(), make_event()); }
@@ -797,6 +1913,143 @@ tamed void fd::accept(struct sockaddr *addr_out, socklen_t *addrlen_out,
     done.trigger(fd(f));
 }
 
+static int accept_nonblocking(int listen_fd) {
+#if HAVE_ACCEPT4
+    int f = ::accept4(listen_fd, nullptr, nullptr,
+                      SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    int f = ::accept(listen_fd, nullptr, nullptr);
+    if (f >= 0) {
+        fd::make_nonblocking(f);
+        fcntl(f, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    return f >= 0 ? f : -errno;
+}
+
+/** @brief  Construct an admission controller.
+ *  @param  max_live     Maximum number of open connections (0 means no
+ *                       limit).
+ *  @param  fd_headroom  Number of descriptors to keep free below
+ *                       fd::open_limit().
+ */
+accept_control::accept_control(size_t max_live, int fd_headroom)
+    : st_(std::make_shared<state>()), max_live_(max_live),
+      fd_headroom_(fd_headroom), open_limit_(fd::open_limit()) {
+}
+
+/** @brief  Return true if another connection may be accepted now. */
+bool accept_control::admit() {
+    if (max_live_ != 0 && st_->live >= max_live_) {
+        return false;
+    }
+    return open_limit_ < 0
+        || st_->next_fd < open_limit_ - std::max(fd_headroom_, 0);
+}
+
+// Count f as live until it closes. Descriptors are numbered lowest-free
+// first, so f's number also estimates how many descriptors are open.
+void accept_control::track(fd& f) {
+    std::shared_ptr<state> st = st_;
+    int fdnum = f.fdnum();
+    ++st->live;
+    st->next_fd = std::max(st->next_fd, fdnum + 1);
+    f.at_close(fun_event([st, fdnum]() {
+        --st->live;
+        st->next_fd = std::min(st->next_fd, fdnum);
+        st->release.trigger();
+    }));
+}
+
+// Accepting failed for lack of descriptors: refuse until retry().
+void accept_control::exhausted() {
+    st_->next_fd = std::max(st_->next_fd, open_limit_);
+}
+
+// Descriptors closed elsewhere are invisible to the estimate, so after a
+// wait, forget it; the next accepted descriptor's number renews it.
+void accept_control::retry() {
+    open_limit_ = fd::open_limit();
+    st_->next_fd = 0;
+}
+
+/** @brief  Accept a batch of new connections.
+ *  @param       max      Maximum number of connections.
+ *  @param[out]  out      Accepted file descriptors are appended here.
+ *  @param       control  Admission control (may be null).
+ *  @param       done     Event triggered on completion.
+ *
+ *  Waits until at least one connection is accepted, then keeps accepting
+ *  without blocking until the backlog is empty or @a max connections have
+ *  been accepted. The new file descriptors are nonblocking and
+ *  close-on-exec; where available, @c accept4() sets both flags in the
+ *  same system call. @a done is triggered with 0 on success or a
+ *  negative error code; errors after the first connection end the batch
+ *  early and are reported by the next call.
+ *
+ *  If @a control is not null, accepted connections count against it and
+ *  accepting stops while it refuses admission. A call that has accepted
+ *  nothing then waits, rechecking when a counted connection closes and
+ *  every accept_control::retry_msec milliseconds. EMFILE and ENFILE
+ *  errors pause accepting in the same way instead of being reported.
+ *
+ *  Draining a busy backlog can take a long time without blocking; loops
+ *  calling accept_many() should yield, for instance with at_asap(), after
+ *  a full batch.
+ */
+tamed void fd::accept_many(size_t max, std::vector<fd>& out,
+                           accept_control* control, event<int> done) {
+    tamed {
+        size_t n = 0;
+        int f, ret = 0;
+        fdref fi(*this, fdref::weak);
+    }
+
+    if (!fi) {
+        done.trigger(-EBADF);
+        return;
+    }
+
+    twait { fi.acquire_read(make_event()); }
+
+    while (n != max && done && fi) {
+        if (control && !control->admit()) {
+            if (n != 0) {
+                break;
+            }
+            twait {
+                event<> e = make_event();
+                control->at_release(e);
+                tamer::at_delay_msec(accept_control::retry_msec, e);
+            }
+            control->retry();
+            continue;
+        }
+        f = accept_nonblocking(fi.fdnum());
+        if (f >= 0) {
+            out.push_back(fd(f));
+            if (control) {
+                control->track(out.back());
+            }
+            ++n;
+        } else if (f == -EAGAIN || f == -EWOULDBLOCK) {
+            if (n != 0) {
+                break;
+            }
+            twait { tamer::at_fd_read(fi.fdnum(), make_event()); }
+        } else if (control && (f == -EMFILE || f == -ENFILE)) {
+            control->exhausted();
+        } else if (f != -EINTR && f != -ECONNABORTED) {
+            if (n == 0) {
+                ret = f;
+            }
+            break;
+        }
+    }
+
+    done.trigger(ret ? ret : (n || fi ? 0 : -ECANCELED));
+}
+
 /** @brief  Connect socket file descriptor.
  *  @param  addr     Remote address.
  *  @param  addrlen  Length of remote address.
@@ -811,6 +2064,7 @@ tamed void fd::connect(const struct sockaddr *addr, socklen_t addrlen,
     tamed {
         int x, ret(0);
         fdref fi(*this, fdref::weak);
+        std::shared_ptr<event<>> ioc;
     }
 
     if (!fi) {
@@ -820,6 +2074,24 @@ tamed void fd::connect(const struct sockaddr *addr, socklen_t addrlen,
 
     twait { fi.acquire_write(make_event()); }
 
+    if (fi && fi.completion_io()) {
+        ret = -ECANCELED;
+        twait {
+            event<int> ioe = make_event(ret);
+            tie_io_cancel(ioc, done, ioe);
+            fd_io io(fd_io_connect,
+                     const_cast<struct sockaddr*>(addr), addrlen);
+            if (!driver::main->at_fd_io(fi.fdnum(), io, ioe)) {
+                ioe.trigger(-EAGAIN);
+            }
+        }
+        if (ret != -EAGAIN) {
+            done.trigger(ret);
+            return;
+        }
+        ret = 0;
+    }
+
     x = ::connect(fi.fdnum(), addr, addrlen);
     if (x == -1 && errno != EINPROGRESS) {
         ret = -errno;
@@ -914,12 +2186,41 @@ int fd::open_limit(int n) {
  *  valid() or error() on the resulting file descriptor.
  */
 fd tcp_listen(int port, int backlog)
+{
+    return tcp_listen(port, backlog, 0);
+}
+
+/** @brief  Open a TCP listening socket receiving connections to @a port.
+ *  @param  port     Listening port (in host byte order).
+ *  @param  backlog  Maximum connection backlog.
+ *  @param  flags    Flags, taken from tcp_listen_flags.
+ *  @return File descriptor.
+ *
+ *  Like tcp_listen(int, int). If @a flags contains tcp_listen_reuseport,
+ *  the socket is also opened with the @c SO_REUSEPORT option, so that
+ *  several listeners, typically one per driver thread, can bind the same
+ *  port and the kernel spreads incoming connections among them. Fails with
+ *  -ENOTSUP where @c SO_REUSEPORT is unavailable.
+ */
+fd tcp_listen(int port, int backlog, int flags)
 {
     fd f = fd::socket(AF_INET, SOCK_STREAM, 0);
     if (f) {
         // Default to reusing port addresses.  Don't worry if it fails
         int yes = 1;
         (void) setsockopt(f.fdnum(), SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int));
+        if (flags & tcp_listen_reuseport) {
+#ifdef SO_REUSEPORT
+            if (setsockopt(f.fdnum(), SOL_SOCKET, SO_REUSEPORT,
+                           &yes, sizeof(int)) != 0) {
+                f.close(-errno);
+                return f;
+            }
+#else
+            f.close(-ENOTSUP);
+            return f;
+#endif
+        }
 
         struct sockaddr_in saddr;
         saddr.sin_family = AF_INET;
@@ -964,7 +2265,7 @@ tamed void tcp_connect(struct in_addr addr, int port, event<fd> result) {
     if (ret < 0 && f) {
         f.close(ret);
     }
-    result.trigger(f);
+    result.trigger(std::move(f));
 }
 
 tamed void udp_connect(struct in_addr addr, int port, event<fd> result) {
@@ -985,7 +2286,7 @@ tamed void udp_connect(struct in_addr addr, int port, event<fd> result) {
     if (ret < 0 && f) {
         f.close(ret);
     }
-    result.trigger(f);
+    result.trigger(std::move(f));
 }
 
 
@@ -1040,7 +2341,7 @@ tamed void unix_stream_connect(std::string path, event<fd> result) {
     if (ret < 0 && f) {
         f.close(ret);
     }
-    result.trigger(f);
+    result.trigger(std::move(f));
 }
 
 
@@ -197,15 +197,11 @@ class http_parser : public tamed_class {
                                          const http_message& m,
                                          bool include_content_length);
     static inline std::string prepare_headers(const http_message& m,
-                                              std::string& body,
                                               bool is_response);
     static inline void send_message(fd f, std::string headers,
                                     std::string body, event<> done);
-    static void send_two(fd f, std::string a, std::string b, event<> done);
 
     class closure__receive__2fdQ12http_message_; void receive(closure__receive__2fdQ12http_message_&);
-    class closure__send_response_chunk__2fdSsQ_; static void send_response_chunk(closure__send_response_chunk__2fdSsQ_&);
-    class closure__send_two__2fdSsSsQ_; static void send_two(closure__send_two__2fdSsSsQ_&);
 };
 
 inline http_message::http_message()
@@ -444,10 +440,9 @@ inline void http_parser::clear_should_keep_alive() {
 
 inline void http_parser::send_message(fd f, std::string headers,
                                       std::string body, event<> done) {
-    if (body.empty())
-        f.write(headers, done);
-    else
-        send_two(f, headers, body, done);
+    f.enqueue(TAMER_MOVE(headers));
+    f.enqueue(TAMER_MOVE(body));
+    f.flush(done);
 }
 
 } // namespace tamer
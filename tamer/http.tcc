@@ -467,7 +467,6 @@ void http_parser::unparse_request_headers(std::ostringstream& buf,
 }
 
 inline std::string http_parser::prepare_headers(const http_message& m,
-                                                std::string& body,
                                                 bool is_response) {
     std::ostringstream buf;
     if (is_response) {
@@ -475,28 +474,18 @@ inline std::string http_parser::prepare_headers(const http_message& m,
     } else {
         unparse_request_headers(buf, m);
     }
-    if (buf.tellp() + std::ostringstream::pos_type(body.length()) < 16384) {
-        buf << TAMER_MOVE(body);
-        body.clear();
-    }
     return buf.str();
 }
 
-tamed static void http_parser::send_two(fd f, std::string a,
-                                        std::string b, event<> done) {
-    twait { f.write(TAMER_MOVE(a), make_event()); }
-    f.write(TAMER_MOVE(b), done);
-}
-
 void http_parser::send_request(fd f, const http_message& m, event<> done) {
     std::string body = m.body();
-    std::string headers = prepare_headers(m, body, false);
-    send_message(f, headers, body, done);
+    std::string headers = prepare_headers(m, false);
+    send_message(f, TAMER_MOVE(headers), TAMER_MOVE(body), done);
 }
 
 void http_parser::send_request(fd f, http_message&& m, event<> done) {
-    std::string headers = prepare_headers(m, m.body_, false);
-    send_message(f, headers, TAMER_MOVE(m.body_), done);
+    std::string headers = prepare_headers(m, false);
+    send_message(f, TAMER_MOVE(headers), TAMER_MOVE(m.body_), done);
 }
 
 void http_parser::unparse_response_headers(std::ostringstream& buf,
@@ -524,38 +513,35 @@ void http_parser::unparse_response_headers(std::ostringstream& buf,
 
 void http_parser::send_response(fd f, const http_message& m, event<> done) {
     std::string body = m.body();
-    std::string headers = prepare_headers(m, body, true);
-    send_message(f, headers, body, done);
+    std::string headers = prepare_headers(m, true);
+    send_message(f, TAMER_MOVE(headers), TAMER_MOVE(body), done);
 }
 
 void http_parser::send_response(fd f, http_message&& m, event<> done) {
-    std::string headers = prepare_headers(m, m.body_, true);
-    send_message(f, headers, TAMER_MOVE(m.body_), done);
+    std::string headers = prepare_headers(m, true);
+    send_message(f, TAMER_MOVE(headers), TAMER_MOVE(m.body_), done);
 }
 
 void http_parser::send_response_headers(fd f, const http_message& m,
                                         event<> done) {
     std::ostringstream buf;
     unparse_response_headers(buf, m, false);
-    f.write(buf.str(), done);
+    f.enqueue(buf.str());
+    f.flush(done);
 }
 
-tamed static void http_parser::send_response_chunk(fd f, std::string s,
-                                                   event<> done) {
-    tamed { std::ostringstream buf; }
-    buf << s.length() << "\r\n";
-    if (s.length() <= 16384) {
-        buf << s << "\r\n";
-        f.write(buf.str(), done);
-    } else {
-        twait { f.write(buf.str(), make_event()); }
-        twait { f.write(TAMER_MOVE(s), make_event()); }
-        f.write("\r\n", 2, done);
-    }
+void http_parser::send_response_chunk(fd f, std::string s, event<> done) {
+    std::ostringstream buf;
+    buf << std::hex << s.length() << "\r\n";
+    f.enqueue(buf.str());
+    f.enqueue(TAMER_MOVE(s));
+    f.enqueue(std::string("\r\n", 2));
+    f.flush(done);
 }
 
 void http_parser::send_response_end(fd f, event<> done) {
-    f.write("0\r\n\r\n", 5, done);
+    f.enqueue(std::string("0\r\n\r\n", 5));
+    f.flush(done);
 }
 
 void http_parser::send(fd f, const http_message& m, event<> done) {
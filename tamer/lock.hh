@@ -25,6 +25,7 @@ class mutex {
     inline mutex();
 
     inline void acquire(event<> done);
+    inline bool try_acquire();
     inline void release();
 
     inline void acquire_shared(event<> done);
@@ -41,6 +42,7 @@ class mutex {
     wait *wait_;
     wait **wait_tailp_;
 
+    inline bool try_acquire(int shared);
     void acquire(int shared, event<> done);
     class closure__acquire__iQ_;
     void acquire(closure__acquire__iQ_ &);
@@ -59,13 +61,37 @@ inline mutex::mutex()
     : locked_(0), wait_(), wait_tailp_(&wait_) {
 }
 
+inline bool mutex::try_acquire(int shared) {
+    if (!wait_ && (shared > 0 ? locked_ != -1 : locked_ == 0)) {
+        locked_ += shared;
+        return true;
+    } else {
+        return false;
+    }
+}
+
 /** @brief  Acquire the mutex for exclusive access.
  *  @param  done  Event triggered when the mutex is acquired.
  *
  *  The mutex must later be released with the release() method.
  */
 inline void mutex::acquire(event<> done) {
-    acquire(-1, done);
+    // an uncontended acquire needs no closure
+    if (done && try_acquire(-1)) {
+        done.trigger();
+    } else {
+        acquire(-1, std::move(done));
+    }
+}
+
+/** @brief  Acquire the mutex for exclusive access if that is possible
+ *  without waiting.
+ *  @return  True iff the mutex was acquired.
+ *
+ *  A successful try_acquire() must later be matched by release().
+ */
+inline bool mutex::try_acquire() {
+    return try_acquire(-1);
 }
 
 /** @brief  Release a mutex acquired for exclusive access.
@@ -84,7 +110,11 @@ inline void mutex::release() {
  *  The mutex must later be released with the release_shared() method.
  */
 inline void mutex::acquire_shared(event<> done) {
-    acquire(1, done);
+    if (done && try_acquire(1)) {
+        done.trigger();
+    } else {
+        acquire(1, std::move(done));
+    }
 }
 
 /** @brief  Release a mutex acquired for shared access.
@@ -87,8 +87,7 @@ tamed void mutex::acquire(int shared, event<> done) {
     if (!done) {
         return;
     }
-    if (!wait_ && (shared > 0 ? locked_ != -1 : locked_ == 0)) {
-        locked_ += shared;
+    if (try_acquire(shared)) {
         done.trigger();
         return;
     }
@@ -0,0 +1,123 @@
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <tamer/offload.hh>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace tamer {
+namespace tamerpriv {
+namespace {
+
+// A fixed pool of threads sharing one FIFO task queue. Tasks are only
+// submitted from driver threads, never by the workers themselves, so
+// per-thread queues would buy nothing.
+class offload_pool {
+  public:
+    explicit offload_pool(unsigned nthreads);
+
+    void submit(offload_task* t);
+
+  private:
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<offload_task*> q_;   // protected by m_
+    unsigned nsleeping_ = 0;        // protected by m_
+
+    void run();
+};
+
+offload_pool::offload_pool(unsigned nthreads) {
+    for (unsigned i = 0; i != nthreads; ++i) {
+        std::thread(&offload_pool::run, this).detach();
+    }
+}
+
+void offload_pool::submit(offload_task* t) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        q_.push_back(t);
+        wake = nsleeping_ != 0;
+    }
+    if (wake) {
+        cv_.notify_one();
+    }
+}
+
+void offload_pool::run() {
+    while (true) {
+        offload_task* t;
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            ++nsleeping_;
+            cv_.wait(lk, [this] { return !q_.empty(); });
+            --nsleeping_;
+            t = q_.front();
+            q_.pop_front();
+        }
+        // after the trigger, the origin thread may delete t at any time
+        remote_event complete(std::move(t->complete_));
+        try {
+            t->run();
+        } catch (...) {
+            t->threw_ = true;
+        }
+        complete.trigger();
+    }
+}
+
+std::mutex pool_m;
+offload_pool* pool;
+unsigned pool_nthreads;
+
+} // namespace
+
+void offload_submit(offload_task* t) {
+    assert(t->complete_);
+    offload_pool* p = __atomic_load_n(&pool, __ATOMIC_ACQUIRE);
+    if (!p) {
+        std::lock_guard<std::mutex> lk(pool_m);
+        if (!(p = pool)) {
+            unsigned n = pool_nthreads;
+            if (!n) {
+                n = std::max(std::thread::hardware_concurrency(), 1U);
+            }
+            // the pool lives until the process exits
+            p = new offload_pool(n);
+            __atomic_store_n(&pool, p, __ATOMIC_RELEASE);
+        }
+    }
+    p->submit(t);
+}
+
+} // namespace tamerpriv
+
+/** @brief  Set the size of the offload thread pool.
+ *  @param  nthreads  Number of threads; 0 means one per CPU.
+ *  @return  True unless the pool has already started.
+ *
+ *  The pool starts on the first call to offload(). */
+bool initialize_offload(unsigned nthreads) {
+    std::lock_guard<std::mutex> lk(tamerpriv::pool_m);
+    if (tamerpriv::pool) {
+        return false;
+    }
+    tamerpriv::pool_nthreads = nthreads;
+    return true;
+}
+
+} // namespace tamer
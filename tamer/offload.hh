@@ -0,0 +1,119 @@
+#ifndef TAMER_OFFLOAD_HH
+#define TAMER_OFFLOAD_HH 1
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <tamer/tamer.hh>
+namespace tamer {
+
+/** @file <tamer/offload.hh>
+ *  @brief  Running CPU-bound work on a thread pool.
+ */
+
+namespace tamerpriv {
+class offload_task {
+  public:
+    virtual ~offload_task() {
+    }
+    virtual void run() = 0;
+
+    remote_event complete_;
+    bool threw_ = false;        // run() exited with an exception
+};
+
+void offload_submit(offload_task* t);
+
+template <typename F, typename R>
+class offload_value_task : public offload_task {
+  public:
+    offload_value_task(F f, event<R> done)
+        : f_(std::move(f)), done_(std::move(done)) {
+    }
+    void run() {
+        result_ = f_();
+    }
+    static void complete(offload_value_task<F, R>* t) {
+        if (t->threw_) {
+            t->done_.unblock();
+        } else {
+            t->done_.trigger(std::move(t->result_));
+        }
+        delete t;
+    }
+  private:
+    F f_;
+    event<R> done_;
+    R result_;
+};
+
+template <typename F>
+class offload_void_task : public offload_task {
+  public:
+    offload_void_task(F f, event<> done)
+        : f_(std::move(f)), done_(std::move(done)) {
+    }
+    void run() {
+        f_();
+    }
+    static void complete(offload_void_task<F>* t) {
+        t->done_.trigger();
+        delete t;
+    }
+  private:
+    F f_;
+    event<> done_;
+};
+} // namespace tamerpriv
+
+bool initialize_offload(unsigned nthreads);
+
+/** @brief  Run @a f on the offload thread pool.
+ *  @param  f     Function object returning a value convertible to @a R.
+ *  @param  done  Event triggered with the result of @a f().
+ *
+ *  Calls @a f() on a pool thread, then triggers @a done with the result
+ *  in the calling thread's driver loop. The loop keeps running while the
+ *  call is outstanding. Triggering @a done early does not stop @a f, whose
+ *  result is then discarded. @a R must be default-constructible. @a f
+ *  must not touch Tamer events or file descriptors.
+ *
+ *  If @a f() throws, the exception is discarded and @a done is unblocked
+ *  without a result, so its result slot keeps its old value.
+ *
+ *  @sa initialize_offload
+ */
+template <typename F, typename R>
+void offload(F f, event<R> done) {
+    auto t = new tamerpriv::offload_value_task<F, R>(std::move(f),
+                                                     std::move(done));
+    t->complete_ = remote_event(fun_event(
+        &tamerpriv::offload_value_task<F, R>::complete, t));
+    tamerpriv::offload_submit(t);
+}
+
+/** @brief  Run @a f on the offload thread pool.
+ *  @param  f     Function object.
+ *  @param  done  Event triggered after @a f() returns or throws.
+ *
+ *  Like offload(F, event<R>), for functions whose results are ignored.
+ */
+template <typename F>
+void offload(F f, event<> done) {
+    auto t = new tamerpriv::offload_void_task<F>(std::move(f),
+                                                 std::move(done));
+    t->complete_ = remote_event(fun_event(
+        &tamerpriv::offload_void_task<F>::complete, t));
+    tamerpriv::offload_submit(t);
+}
+
+} // namespace tamer
+#endif /* TAMER_OFFLOAD_HH */
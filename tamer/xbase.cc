@@ -16,12 +16,17 @@
 #include <tamer/adapter.hh>
 #include <stdio.h>
 #include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <stdlib.h>
 
 namespace tamer {
 namespace tamerpriv {
 
 simple_driver::simple_driver()
-    : ccap_(0), cfree_(1), cunblocked_(0), cunblocked_tail_(0), cs_() {
+    : profile_(), ccap_(0), cfree_(1), cunblocked_(0), cunblocked_tail_(0),
+      cs_() {
     grow();
 }
 
@@ -47,6 +52,58 @@ void simple_driver::grow() {
     cs_ = new_cs;
 }
 
+thread_local size_t simple_event_pool::nlive_;
+thread_local size_t simple_event_pool::npeak_;
+
+thread_local void* closure_pool::free_[closure_pool::nclasses];
+
+void* closure_pool::hard_allocate(unsigned sc) {
+    // carve a slab of about 16KB into closures of this class
+    size_t sz = (sc + 1) * granularity;
+    size_t n = std::max(size_t(16384) / sz, size_t(8));
+    char* slab = static_cast<char*>(::operator new(sz * n));
+    for (size_t i = n - 1; i != 1; --i) {
+        *reinterpret_cast<void**>(slab + (i - 1) * sz) = slab + i * sz;
+    }
+    *reinterpret_cast<void**>(slab + (n - 1) * sz) = free_[sc];
+    free_[sc] = slab + sz;
+    return slab;
+}
+
+namespace {
+struct closure_size_record {
+    const char* name;
+    const char* location;
+    size_t size;
+};
+std::mutex closure_sizes_lock;
+std::vector<closure_size_record>* closure_sizes;
+
+void print_closure_sizes() {
+    std::lock_guard<std::mutex> guard(closure_sizes_lock);
+    std::vector<closure_size_record>& v = *closure_sizes;
+    std::stable_sort(v.begin(), v.end(),
+                     [](const closure_size_record& a,
+                        const closure_size_record& b) {
+                         return a.size > b.size;
+                     });
+    fprintf(stderr, "tamer closure sizes:\n");
+    for (auto& r : v) {
+        fprintf(stderr, "%8zu  %s (%s)\n", r.size, r.name, r.location);
+    }
+}
+} // namespace
+
+closure_size_note::closure_size_note(const char* name, const char* location,
+                                     size_t size) {
+    std::lock_guard<std::mutex> guard(closure_sizes_lock);
+    if (!closure_sizes) {
+        closure_sizes = new std::vector<closure_size_record>;
+        atexit(print_closure_sizes);
+    }
+    closure_sizes->push_back(closure_size_record{name, location, size});
+}
+
 void simple_driver::add(closure* c) {
     if (!cfree_) {
         grow();
@@ -199,21 +256,53 @@ void simple_event::unuse_trigger() TAMER_NOEXCEPT {
     }
 }
 
-inline event<> simple_event::at_trigger_event(void (*f)(void*), void* arg) {
-    if (f == trigger_hook) {
-        return event<>::__make(static_cast<simple_event*>(arg));
-    } else {
-        return tamer::fun_event(f, arg);
+// Stacked at_trigger hooks: a list of pooled nodes installed as the
+// event's single hook, chain_hook. Adding a hook never allocates an event.
+// New hooks are pushed on the front; chain_hook reverses the list once so
+// hooks run in the order they were added.
+struct at_trigger_node {
+    void (*f)(void*);
+    void* arg;
+    at_trigger_node* next;
+
+    static inline at_trigger_node* make(void (*f)(void*), void* arg) {
+        void* p = allocate_closure_memory(sizeof(at_trigger_node));
+        return new(p) at_trigger_node{f, arg, nullptr};
+    }
+};
+
+void simple_event::chain_hook(void* arg) {
+    at_trigger_node* n = nullptr;
+    for (at_trigger_node* x = static_cast<at_trigger_node*>(arg); x; ) {
+        at_trigger_node* next = x->next;
+        x->next = n;
+        n = x;
+        x = next;
+    }
+    while (n) {
+        at_trigger_node* next = n->next;
+        if (n->f == trigger_hook) {
+            simple_trigger(static_cast<simple_event*>(n->arg), false);
+        } else {
+            n->f(n->arg);
+        }
+        deallocate_closure_memory(n, sizeof(at_trigger_node));
+        n = next;
     }
 }
 
 void simple_event::hard_at_trigger(simple_event* x, void (*f)(void*),
                                    void* arg) {
     if (x && *x) {
-        event<> t(at_trigger_event(x->at_trigger_f_, x->at_trigger_arg_));
-        t += at_trigger_event(f, arg);
-        x->at_trigger_f_ = trigger_hook;
-        x->at_trigger_arg_ = t.__release_simple();
+        at_trigger_node* n = at_trigger_node::make(f, arg);
+        if (x->at_trigger_f_ != chain_hook) {
+            n->next =
+                at_trigger_node::make(x->at_trigger_f_, x->at_trigger_arg_);
+            x->at_trigger_f_ = chain_hook;
+        } else {
+            n->next = static_cast<at_trigger_node*>(x->at_trigger_arg_);
+        }
+        x->at_trigger_arg_ = n;
     } else {
         f(arg);
     }
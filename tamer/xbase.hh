@@ -17,6 +17,8 @@
 #include <string>
 #include <cstdint>
 #include <cassert>
+#include <memory>
+#include <type_traits>
 #include <tamer/autoconf.h>
 namespace tamer {
 
@@ -62,6 +64,7 @@ class abstract_rendezvous;
 class blocking_rendezvous;
 class explicit_rendezvous;
 class closure;
+struct closure_profile;
 
 class simple_event { public:
     // DO NOT derive from this class!
@@ -94,6 +97,9 @@ class simple_event { public:
     static inline void at_trigger(simple_event* x, simple_event* at_trigger);
     static inline void at_trigger(simple_event* x, void (*f)(void*), void* arg);
 
+    static inline void* operator new(size_t size);
+    static inline void operator delete(void* p);
+
   protected:
     abstract_rendezvous* _r;
     uintptr_t _rid;
@@ -113,8 +119,8 @@ class simple_event { public:
     simple_event& operator=(const simple_event&&) = delete;
 
     void unuse_trigger() TAMER_NOEXCEPT;
-    static inline event<> at_trigger_event(void (*f)(void*), void* arg);
     static void trigger_hook(void* arg);
+    static void chain_hook(void* arg);
     static void hard_at_trigger(simple_event* x, void (*f)(void*), void* arg);
 
     void print(const char* prefix, const char* filename = nullptr, int line = 0);
@@ -176,6 +182,8 @@ class simple_driver {
     inline unsigned nclosure_slots() const;
     inline closure* closure_slot(unsigned i) const;
 
+    closure_profile* profile_;
+
   public:
     inline bool has_unblocked() const;
     inline void run_unblocked();
@@ -202,6 +210,7 @@ class simple_driver {
 
     void add(closure* c);
     void grow();
+    void run_unblocked_profiled();
 
     friend class blocking_rendezvous;
     friend class closure;
@@ -325,6 +334,108 @@ class closure {
 };
 
 
+// Per-thread freelists of closure memory, one per 16-byte size class.
+// Memory is carved from slabs and never returned to the system. A closure
+// freed by another thread joins that thread's freelist.
+struct closure_pool {
+    enum { granularity = 16, nclasses = 32,
+           max_size = granularity * nclasses };
+    static thread_local void* free_[nclasses];
+    static void* hard_allocate(unsigned sc);
+
+    template <typename T> static constexpr bool pooled() {
+        return sizeof(T) <= max_size && alignof(T) <= granularity;
+    }
+    template <typename T> static constexpr unsigned size_class() {
+        return (sizeof(T) - 1) / granularity;
+    }
+
+    // Allocate @a size <= max_size bytes, aligned to granularity.
+    static inline void* allocate(size_t size) {
+        unsigned sc = (size - 1) / granularity;
+        if (void* p = free_[sc]) {
+            free_[sc] = *static_cast<void**>(p);
+            return p;
+        }
+        return hard_allocate(sc);
+    }
+    static inline void deallocate(void* p, size_t size) {
+        void*& head = free_[(size - 1) / granularity];
+        *static_cast<void**>(p) = head;
+        head = p;
+    }
+};
+
+// Per-thread simple_event memory, drawn from closure_pool's freelist for
+// sizeof(simple_event). nlive_ and npeak_ count this thread's allocated
+// events; an event freed by another thread counts against that thread.
+struct simple_event_pool {
+    static thread_local size_t nlive_;
+    static thread_local size_t npeak_;
+
+    static inline void* allocate() {
+        if (++nlive_ > npeak_) {
+            npeak_ = nlive_;
+        }
+#if !TAMER_NOCLOSUREPOOL
+        static_assert(closure_pool::pooled<simple_event>(),
+                      "simple_event fits a closure_pool size class");
+        return closure_pool::allocate(sizeof(simple_event));
+#else
+        return ::operator new(sizeof(simple_event));
+#endif
+    }
+    static inline void deallocate(void* p) {
+        --nlive_;
+#if !TAMER_NOCLOSUREPOOL
+        closure_pool::deallocate(p, sizeof(simple_event));
+#else
+        ::operator delete(p);
+#endif
+    }
+};
+
+template <typename T>
+inline T* allocate_closure() {
+#if !TAMER_NOCLOSUREPOOL
+    if (closure_pool::pooled<T>()) {
+        return static_cast<T*>(closure_pool::allocate(sizeof(T)));
+    }
+#endif
+    return std::allocator<T>().allocate(1);
+}
+
+template <typename T>
+inline void deallocate_closure(T* c) {
+    c->~T();
+#if !TAMER_NOCLOSUREPOOL
+    if (closure_pool::pooled<T>()) {
+        closure_pool::deallocate(c, sizeof(T));
+        return;
+    }
+#endif
+    std::allocator<T>().deallocate(c, 1);
+}
+
+// Memory for a coroutine frame, whose size is known only at run time.
+inline void* allocate_closure_memory(size_t size) {
+#if !TAMER_NOCLOSUREPOOL
+    if (size <= closure_pool::max_size) {
+        return closure_pool::allocate(size);
+    }
+#endif
+    return ::operator new(size);
+}
+
+inline void deallocate_closure_memory(void* p, size_t size) {
+#if !TAMER_NOCLOSUREPOOL
+    if (size <= closure_pool::max_size) {
+        return closure_pool::deallocate(p, size);
+    }
+#endif
+    ::operator delete(p);
+}
+
 template <typename T>
 class closure_owner {
   public:
@@ -332,7 +443,9 @@ class closure_owner {
         : c_(&c) {
     }
     inline ~closure_owner() {
-        delete c_;
+        if (c_) {
+            deallocate_closure(c_);
+        }
     }
     inline void reset() {
         c_ = 0;
@@ -341,6 +454,13 @@ class closure_owner {
     T* c_;
 };
 
+// Records a closure's size for the report printed at exit. The tamer
+// compiler emits these when run with --report-closure-sizes.
+class closure_size_note {
+  public:
+    closure_size_note(const char* name, const char* location, size_t size);
+};
+
 template <typename R>
 class rendezvous_owner {
   public:
@@ -401,6 +521,9 @@ inline closure* simple_driver::pop_unblocked() {
 }
 
 inline void simple_driver::run_unblocked() {
+    if (profile_) {
+        return run_unblocked_profiled();
+    }
     while (closure* c = pop_unblocked()) {
         c->tamer_activator_(c);
     }
@@ -572,6 +695,14 @@ inline simple_event::~simple_event() TAMER_NOEXCEPT {
 #endif
 }
 
+inline void* simple_event::operator new(size_t) {
+    return simple_event_pool::allocate();
+}
+
+inline void simple_event::operator delete(void* p) {
+    simple_event_pool::deallocate(p);
+}
+
 inline void simple_event::use(simple_event* e, const char*, int) TAMER_NOEXCEPT {
     if (e) {
         ++e->_refcount;
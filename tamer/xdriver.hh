@@ -15,14 +15,36 @@
  */
 #include <tamer/event.hh>
 #include <csignal>
+#include <cstdio>
 #include <ctime>
 #include <sys/time.h>
+#include <sys/socket.h>
 #include <vector>
 #include <string>
 namespace tamer {
 namespace tamerpriv {
-extern struct timeval recent;
-extern bool need_recent;
+extern thread_local struct timeval recent;
+extern thread_local uint64_t recent_nsec;
+extern thread_local bool need_recent;
+
+inline uint64_t timeval_nsec(const timeval& tv) {
+    if (tv.tv_sec < 0) {
+        return 0;
+    }
+    return uint64_t(tv.tv_sec) * 1000000000 + tv.tv_usec * 1000;
+}
+
+inline timeval nsec_timeval(uint64_t ns) {
+    timeval tv;
+    tv.tv_sec = ns / 1000000000;
+    tv.tv_usec = (ns % 1000000000) / 1000;
+    return tv;
+}
+
+inline void set_recent_nsec(uint64_t ns) {
+    recent_nsec = ns;
+    recent = nsec_timeval(ns);
+}
 } // namespace tamerpriv
 
 enum loop_flags {
@@ -40,7 +62,77 @@ enum fd_actions {
     fd_read = 0,
     fd_write = 1, // order matters
     fd_hangup = 2,
-    nfdactions = 3
+    fd_errqueue = 3,
+    nfdactions = 4
+};
+
+struct driver_stats {
+    uint64_t loops = 0;             // loop iterations
+    uint64_t blocked_nsec = 0;      // time spent waiting for events
+    uint64_t running_nsec = 0;      // time spent between waits
+    unsigned fds = 0;               // fds with registered interest
+    uint64_t fd_adds = 0;           // epoll_ctl calls, or equivalent,
+    uint64_t fd_mods = 0;           //   by kind
+    uint64_t fd_dels = 0;
+    uint64_t poll_saturations = 0;  // fd polls that filled their batch
+    uint64_t timers_pushed = 0;
+    uint64_t timers_fired = 0;
+    uint64_t timers_culled = 0;     // removed after triggering elsewhere
+    unsigned asap = 0;              // at_asap queue depth
+    unsigned preblock = 0;          // at_preblock queue depth
+    unsigned closures_blocked = 0;
+    unsigned events_live = 0;       // this thread's allocated events
+    unsigned events_peak = 0;       //   and their high-water mark
+    uint64_t signals = 0;           // signal dispatches
+};
+
+struct closure_profile_entry {
+    std::string location;           // twait location, file:line
+    uint64_t count;                 // activations
+    uint64_t nsec;                  // total time running
+    uint64_t max_nsec;              // longest activation
+};
+
+// Log-linear histogram of nanosecond durations, accurate to about 6%.
+class latency_histogram {
+  public:
+    enum { sub_bits = 4, nsub = 1 << sub_bits,
+           nbuckets = (64 - sub_bits + 1) * nsub };
+
+    inline void add(uint64_t nsec);
+    void clear();
+
+    uint64_t count() const      { return count_; }
+    uint64_t max() const        { return max_; }
+    uint64_t percentile(double p) const;
+
+    static inline unsigned bucket(uint64_t nsec);
+    static inline uint64_t bucket_low(unsigned b);
+    uint64_t bucket_count(unsigned b) const { return b_[b]; }
+
+  private:
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+    uint64_t b_[nbuckets] = {};
+};
+
+enum fd_io_ops {
+    fd_io_read = 0,
+    fd_io_write = 1,
+    fd_io_readv = 2,
+    fd_io_writev = 3,
+    fd_io_accept = 4,
+    fd_io_connect = 5
+};
+
+struct fd_io {
+    int op;
+    void* data;             // buffer, iovec array, or sockaddr
+    size_t size;            // buffer size, iovec count, or sockaddr length
+    socklen_t* addrlen;     // fd_io_accept only
+
+    inline fd_io(int op, void* data, size_t size,
+                 socklen_t* addrlen = nullptr);
 };
 
 class driver : public tamerpriv::simple_driver {
@@ -54,21 +146,38 @@ class driver : public tamerpriv::simple_driver {
 
     // basic functions
     virtual void at_fd(int fd, int action, event<int> e) = 0;
-    virtual void at_time(const timeval& expiry, event<> e, bool bg) = 0;
+    // drivers override at least one of these: the first adds the default
+    // timer slack, the second ignores its slack
+    virtual void at_time(const timeval& expiry, event<> e, bool bg);
+    virtual void at_time(const timeval& expiry, event<> e, bool bg,
+                         const timeval& slack);
     virtual void at_asap(event<> e) = 0;
     virtual void at_preblock(event<> e) = 0;
     virtual void kill_fd(int fd) = 0;
 
+    virtual bool has_fd_io() const;
+    virtual bool at_fd_io(int fd, const fd_io& io, event<int> done);
+    virtual bool has_fd_errqueue() const;
+
+    void post(event<> e);
+
     inline void at_fd(int fd, int action, event<> e);
     inline void at_time(const timeval& expiry, event<> e);
     inline void at_time(double expiry, event<> e, bool bg = false);
     inline void at_delay(timeval delay, event<> e, bool bg = false);
     void at_delay(double delay, event<> e, bool bg = false);
+    inline void at_delay(timeval delay, event<> e, bool bg,
+                         const timeval& slack);
+    void at_delay(double delay, event<> e, bool bg, double slack);
     inline void at_delay_sec(int delay, event<> e, bool bg = false);
     inline void at_delay_msec(int delay, event<> e, bool bg = false);
     inline void at_delay_usec(int delay, event<> e, bool bg = false);
 
-    static void at_signal(int signo, event<> e,
+    inline const timeval& timer_slack() const;
+    inline void set_timer_slack(const timeval& slack);
+    void set_timer_slack(double slack);
+
+    static bool at_signal(int signo, event<> e,
                           signal_flags flags = signal_default);
 
     typedef void (*error_handler_type)(int fd, int err, std::string msg);
@@ -78,32 +187,138 @@ class driver : public tamerpriv::simple_driver {
     virtual void break_loop() = 0;
     virtual timeval next_wake() const;
 
+    virtual driver_stats stats() const;
+    typedef void (*stats_handler_type)(driver* d, const driver_stats& stats);
+    void set_stats_handler(stats_handler_type h, double period);
+
     virtual void clear();
 
     void blocked_locations(std::vector<std::string>& x);
 
+    void set_closure_profiling(bool on);
+    void closure_profile(std::vector<closure_profile_entry>& x) const;
+    void print_closure_profile(FILE* f, bool folded = false) const;
+    void clear_closure_profile();
+
+    const latency_histogram& loop_latency() const;
+    typedef void (*stall_handler_type)(driver* d, uint64_t nsec,
+                                       const std::vector<closure_profile_entry>& ran);
+    void set_stall_threshold(double threshold, stall_handler_type h = nullptr);
+
     static driver* make_tamer(int flags);
+    static driver* make_uring(int flags = 0);
     static driver* make_libevent();
     static driver* make_libev();
 
-    static driver* main;
+    static thread_local driver* main;
 
     static volatile sig_atomic_t sig_any_active;
     static int sig_pipe[2];
+    // changed only by sig_driver's thread (or before any driver exists)
     static unsigned sig_nforeground;
     static unsigned sig_ntotal;
+    static driver* sig_driver;
+    bool owns_signals();
     void dispatch_signals();
 
+  protected:
+    int post_fd_[2];
+    driver_stats stats_;
+
+    void stats_before_wait();
+    void stats_after_wait();
+
+    inline bool has_posted() const;
+    inline unsigned nremote() const;
+    void run_posted();
+    void clear_posted();
+
 private:
     unsigned index_;
     std::tuple<int> int_placeholder_;
+    timeval timer_slack_ = {0, 0};
+
+    struct posted;
+    posted* posted_ = nullptr;
+    unsigned nremote_ = 0;
+
+    tamerpriv::closure_profile* profile_data_ = nullptr;
+    latency_histogram loop_latency_;
+    uint64_t stall_nsec_ = 0;
+    stall_handler_type stall_handler_ = nullptr;
+
+    tamerpriv::closure_profile* make_profile();
+    void report_stall(uint64_t nsec);
+
+    uint64_t stats_clock_ = 0;
+    stats_handler_type stats_handler_ = nullptr;
+    double stats_period_;
+    unsigned stats_gen_ = 0;
+
+    static void stats_tick(driver* d, unsigned gen);
+
+    void post(tamerpriv::simple_event* se, int flags);
 
     static driver* indexed[capacity];
     static int next_index;
+
+    friend class remote_event;
+};
+
+inline unsigned latency_histogram::bucket(uint64_t nsec) {
+    if (nsec < nsub) {
+        return nsec;
+    }
+    unsigned e = 63 - __builtin_clzll(nsec);
+    return (e - sub_bits + 1) * nsub + ((nsec >> (e - sub_bits)) & (nsub - 1));
+}
+
+inline uint64_t latency_histogram::bucket_low(unsigned b) {
+    if (b < nsub) {
+        return b;
+    }
+    unsigned e = b / nsub + sub_bits - 1;
+    return uint64_t(nsub + b % nsub) << (e - sub_bits);
+}
+
+inline void latency_histogram::add(uint64_t nsec) {
+    ++b_[bucket(nsec)];
+    ++count_;
+    if (nsec > max_) {
+        max_ = nsec;
+    }
+}
+
+class remote_event {
+  public:
+    inline remote_event() noexcept;
+    explicit remote_event(event<> e);
+    inline remote_event(remote_event&& x) noexcept;
+    inline remote_event& operator=(remote_event&& x) noexcept;
+    inline ~remote_event();
+
+    explicit inline operator bool() const;
+    inline driver* target() const;
+
+    inline void trigger();
+    inline void operator()();
+
+  private:
+    driver* d_;
+    tamerpriv::simple_event* se_;
+
+    remote_event(const remote_event&) = delete;
+    remote_event& operator=(const remote_event&) = delete;
 };
 
 timeval now();
+uint64_t now_nsec();
 inline const timeval& recent();
+inline uint64_t recent_nsec();
+
+inline fd_io::fd_io(int op_, void* data_, size_t size_, socklen_t* addrlen_)
+    : op(op_), data(data_), size(size_), addrlen(addrlen_) {
+}
 
 inline driver* driver::by_index(unsigned index) {
     return index < capacity ? indexed[index] : 0;
@@ -113,6 +328,14 @@ inline unsigned driver::index() const {
     return index_;
 }
 
+inline bool driver::has_posted() const {
+    return __atomic_load_n(&posted_, __ATOMIC_RELAXED) != nullptr;
+}
+
+inline unsigned driver::nremote() const {
+    return nremote_;
+}
+
 inline void driver::at_fd(int fd, int action, event<> e) {
     at_fd(fd, action, event<int>(e, int_placeholder_));
 }
@@ -133,6 +356,12 @@ inline void driver::at_delay(timeval delay, event<> e, bool bg) {
     at_time(delay, e, bg);
 }
 
+inline void driver::at_delay(timeval delay, event<> e, bool bg,
+                             const timeval& slack) {
+    timeradd(&delay, &recent(), &delay);
+    at_time(delay, e, bg, slack);
+}
+
 inline void driver::at_delay_sec(int delay, event<> e, bool bg) {
     if (delay <= 0) {
         at_asap(e);
@@ -165,6 +394,55 @@ inline void driver::at_delay_usec(int delay, event<> e, bool bg) {
     }
 }
 
+inline const timeval& driver::timer_slack() const {
+    return timer_slack_;
+}
+
+inline void driver::set_timer_slack(const timeval& slack) {
+    timer_slack_ = slack;
+}
+
+inline remote_event::remote_event() noexcept
+    : d_(nullptr), se_(nullptr) {
+}
+
+inline remote_event::remote_event(remote_event&& x) noexcept
+    : d_(x.d_), se_(x.se_) {
+    x.d_ = nullptr;
+    x.se_ = nullptr;
+}
+
+inline remote_event& remote_event::operator=(remote_event&& x) noexcept {
+    std::swap(d_, x.d_);
+    std::swap(se_, x.se_);
+    return *this;
+}
+
+inline remote_event::~remote_event() {
+    if (d_) {
+        d_->post(se_, 3);
+    }
+}
+
+inline remote_event::operator bool() const {
+    return d_ != nullptr;
+}
+
+inline driver* remote_event::target() const {
+    return d_;
+}
+
+inline void remote_event::trigger() {
+    if (driver* d = d_) {
+        d_ = nullptr;
+        d->post(se_, 1);
+    }
+}
+
+inline void remote_event::operator()() {
+    trigger();
+}
+
 namespace tamerpriv {
 inline void blocking_rendezvous::block(closure& c, unsigned position) {
     block(tamer::driver::main, c, position);
@@ -0,0 +1,128 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+#include <arpa/inet.h>
+
+// Exercise the io_uring driver (or the Tamer driver, if io_uring is
+// unavailable): fd readiness, interest changes, timers, close, and
+// completion-based read, write, accept, and connect.
+
+tamed void pingpong(tamer::fd r, tamer::fd w, int n, tamer::event<int> done) {
+    tvars { char c = 'A'; size_t x; int ret; int i; }
+    for (i = 0; i != n; ++i) {
+        twait { w.write(&c, 1, x, make_event(ret)); }
+        twait { r.read(&c, 1, x, make_event(ret)); }
+        if (ret != 0 || x != 1) {
+            break;
+        }
+    }
+    done(i);
+}
+
+tamed void echo(tamer::fd r, tamer::fd w) {
+    tvars { char c; size_t x; int ret; }
+    while (true) {
+        twait { r.read(&c, 1, x, make_event(ret)); }
+        if (ret != 0 || x != 1) {
+            break;
+        }
+        twait { w.write(&c, 1, x, make_event(ret)); }
+    }
+    printf("echo closed %d %zu\n", ret, x);
+}
+
+tamed void timeout_read(tamer::fd f, tamer::event<> done) {
+    tvars { char c; size_t x = 0; int ret = 1; }
+    twait {
+        f.read(&c, 1, x, tamer::add_timeout_msec(20, make_event(ret), -ETIMEDOUT));
+    }
+    printf("timeout %s %zu\n", ret == -ETIMEDOUT ? "ETIMEDOUT" : "?", x);
+    done();
+}
+
+// Data read by a canceled completion must reach the next read.
+tamed void canceled_read(tamer::fd r, tamer::fd w, tamer::event<> done) {
+    tvars {
+        char buf[2];
+        size_t x = 0;
+        int ret = 0;
+        tamer::rendezvous<> pending;
+        tamer::event<int> e;
+    }
+    e = tamer::make_event(pending, ret);
+    r.read(buf, 2, x, e);
+    twait { tamer::at_delay_msec(5, make_event()); }
+    // the read may complete before its cancellation takes effect
+    if (::write(w.fdnum(), "xy", 2) == 2) {
+        e.unblocker().trigger();
+    }
+    twait(pending);
+    printf("canceled %zu\n", x);
+    twait { r.read(buf, 2, x, make_event(ret)); }
+    printf("read after cancel %d %.*s\n", ret, int(x), buf);
+    done();
+}
+
+tamed void sockets(tamer::event<> done) {
+    tvars {
+        tamer::fd l, a, c;
+        struct sockaddr_in sin;
+        socklen_t sinlen = sizeof(sin);
+        char buf[6];
+        size_t x;
+        int ret;
+    }
+    l = tamer::tcp_listen(0);
+    getsockname(l.fdnum(), (struct sockaddr*) &sin, &sinlen);
+    twait {
+        l.accept(make_event(a));
+        tamer::tcp_connect(sin.sin_addr, ntohs(sin.sin_port), make_event(c));
+    }
+    twait { c.write("hello", 5, x, make_event(ret)); }
+    twait { a.read(buf, 5, x, make_event(ret)); }
+    buf[x] = 0;
+    printf("socket %s %d %s %zu\n", a && c ? "ok" : "?", ret, buf, x);
+    l.close();
+    a.close();
+    c.close();
+    done();
+}
+
+tamed void run() {
+    tvars { tamer::fd a[2], b[2], idle[2]; int n; }
+    tamer::fd::pipe(a);
+    tamer::fd::pipe(b);
+    tamer::fd::pipe(idle);
+    echo(a[0], b[1]);
+    twait { pingpong(b[0], a[1], 1000, make_event(n)); }
+    printf("pingpong %d\n", n);
+    twait { timeout_read(idle[0], make_event()); }
+    twait { canceled_read(idle[0], idle[1], make_event()); }
+    twait { sockets(make_event()); }
+    a[1].close();
+    idle[0].close();
+    idle[1].close();
+}
+
+int main(int, char**) {
+    tamer::initialize(tamer::init_uring);
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
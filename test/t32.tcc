@@ -0,0 +1,136 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// Exercise edge-triggered epoll: readiness consumed by a wakeup, readiness
+// cached while nobody waits, hangup, and fd numbers reused after
+// kill_fd() or after a hangup and a raw close().
+
+tamed void pingpong(tamer::fd f, int n, tamer::event<int> done) {
+    tvars { char c = 'A'; size_t x; int ret; int i; }
+    for (i = 0; i != n; ++i) {
+        twait { f.write(&c, 1, x, make_event(ret)); }
+        twait { f.read(&c, 1, x, make_event(ret)); }
+        if (ret != 0 || x != 1) {
+            break;
+        }
+    }
+    done(i);
+}
+
+tamed void echo(tamer::fd f) {
+    tvars { char c; size_t x; int ret; }
+    while (true) {
+        twait { f.read(&c, 1, x, make_event(ret)); }
+        if (ret != 0 || x != 1) {
+            break;
+        }
+        twait { f.write(&c, 1, x, make_event(ret)); }
+    }
+    printf("echo closed %d %zu\n", ret, x);
+}
+
+tamed void readiness(tamer::event<> done) {
+    tvars { tamer::fd p[2]; char c = 'B'; int ret; }
+    tamer::fd::pipe(p);
+
+    // readiness is consumed by the wakeup that reports it
+    ::write(p[1].fdnum(), &c, 1);
+    twait { tamer::at_fd_read(p[0].fdnum(), make_event(ret)); }
+    ret = ::read(p[0].fdnum(), &c, 1) == 1 ? ret : -1;
+    printf("ready %d\n", ret);
+    ::read(p[0].fdnum(), &c, 1);
+    twait {
+        tamer::at_fd_read(p[0].fdnum(),
+                          tamer::add_timeout_msec(20, make_event(ret), -ETIMEDOUT));
+    }
+    printf("drained %s\n", ret == -ETIMEDOUT ? "ETIMEDOUT" : "?");
+
+    // readiness that arrives while nobody waits is remembered
+    ::write(p[1].fdnum(), &c, 1);
+    twait { tamer::at_delay_msec(20, make_event()); }
+    ret = 1;
+    twait {
+        tamer::at_fd_read(p[0].fdnum(),
+                          tamer::add_timeout_msec(20, make_event(ret), -ETIMEDOUT));
+    }
+    printf("cached %d\n", ret);
+    p[0].close();
+    p[1].close();
+    done();
+}
+
+tamed void reuse(tamer::event<> done) {
+    tvars { int p[2]; char c = 'C'; int ret; }
+    pipe(p);
+    ::write(p[1], &c, 1);
+    twait { tamer::at_fd_read(p[0], make_event(ret)); }
+    ::read(p[0], &c, 1);
+    tamer::driver::main->kill_fd(p[0]);
+    ::close(p[0]);
+    ::close(p[1]);
+
+    // kill_fd forgot the registration the kernel dropped on close
+    pipe(p);
+    ::write(p[1], &c, 1);
+    twait {
+        tamer::at_fd_read(p[0],
+                          tamer::add_timeout_msec(20, make_event(ret), -ETIMEDOUT));
+    }
+    printf("reused %d\n", ret);
+    ::read(p[0], &c, 1);
+    ::close(p[1]);
+    twait { tamer::at_fd_read(p[0], make_event(ret)); }
+    printf("hangup %s\n", ret == tamer::outcome::closed ? "closed" : "?");
+    ::close(p[0]);
+
+    // a raw close after a hangup is noticed without kill_fd, and the
+    // cached hangup does not outlive the file
+    pipe(p);
+    twait {
+        tamer::at_fd_read(p[0],
+                          tamer::add_timeout_msec(20, make_event(ret), -ETIMEDOUT));
+    }
+    printf("reused hangup %s\n", ret == -ETIMEDOUT ? "ETIMEDOUT" : "?");
+    ::close(p[0]);
+    ::close(p[1]);
+    done();
+}
+
+tamed void run() {
+    tvars { int sv[2]; tamer::fd a, b; int n; }
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    a = tamer::fd(sv[0]);
+    b = tamer::fd(sv[1]);
+    a.make_nonblocking();
+    b.make_nonblocking();
+    echo(b);
+    twait { pingpong(a, 1000, make_event(n)); }
+    printf("pingpong %d\n", n);
+    twait { readiness(make_event()); }
+    twait { reuse(make_event()); }
+    a.close();
+}
+
+int main(int, char**) {
+    tamer::initialize(tamer::init_tamer | tamer::init_epoll_et);
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
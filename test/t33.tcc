@@ -0,0 +1,142 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <thread>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// Run one driver per thread, each serving its own SO_REUSEPORT listener.
+
+enum { nthreads = 4, nclients = 64 };
+std::atomic<int> nserved(0);
+std::atomic<int> nsigrefused(0);
+tamer::driver* drivers[nthreads];
+int quitpipe[nthreads][2];
+
+tamed void serve_one(tamer::fd cfd) {
+    tvars { char c; size_t x; int ret; }
+    twait { cfd.read(&c, 1, x, make_event(ret)); }
+    if (ret == 0 && x == 1) {
+        twait { cfd.write(&c, 1, x, make_event(ret)); }
+        ++nserved;
+    }
+    cfd.close();
+}
+
+tamed void quit(tamer::fd l, int quitfd) {
+    twait { tamer::at_fd_read(quitfd, make_event()); }
+    l.close();
+}
+
+tamed void serve(tamer::fd l, int quitfd) {
+    tvars { tamer::fd cfd; }
+    quit(l, quitfd);
+    while (l) {
+        twait { l.accept(make_event(cfd)); }
+        if (cfd) {
+            serve_one(cfd);
+        }
+    }
+}
+
+void server_thread(int i, tamer::fd* l) {
+    tamer::initialize(tamer::init_tamer);
+    drivers[i] = tamer::driver::main;
+    {
+        // signals belong to the main thread
+        tamer::rendezvous<> r;
+        nsigrefused += !tamer::at_signal(SIGUSR2, tamer::make_event(r));
+    }
+    serve(*l, quitpipe[i][0]);
+    delete l;
+    tamer::loop();
+    tamer::cleanup();
+}
+
+tamed void client(int port, tamer::event<> done) {
+    tvars { tamer::fd f; char c = 'x'; size_t x; int ret; }
+    twait { tamer::tcp_connect(port, make_event(f)); }
+    twait { f.write(&c, 1, x, make_event(ret)); }
+    twait { f.read(&c, 1, x, make_event(ret)); }
+    f.close();
+    done();
+}
+
+tamed void clients(int port, tamer::event<> done) {
+    tvars { int i; }
+    twait {
+        for (i = 0; i != nclients; ++i) {
+            client(port, make_event());
+        }
+    }
+    done();
+}
+
+int main(int, char**) {
+    tamer::initialize(tamer::init_tamer);
+    tamer::rendezvous<> sigr;
+    tamer::event<> sige = tamer::make_event(sigr);
+    tamer::driver::at_signal(SIGUSR2, sige, tamer::signal_background);
+
+    tamer::fd* ls[nthreads];
+    int port = 0;
+    for (int i = 0; i != nthreads; ++i) {
+        ls[i] = new tamer::fd(tamer::tcp_listen(port, 128, tamer::tcp_listen_reuseport));
+        if (!*ls[i]) {
+            fprintf(stderr, "tcp_listen: %s\n", strerror(-ls[i]->error()));
+            return 1;
+        }
+        if (i == 0) {
+            struct sockaddr_in sin;
+            socklen_t sinlen = sizeof(sin);
+            getsockname(ls[0]->fdnum(), (struct sockaddr*) &sin, &sinlen);
+            port = ntohs(sin.sin_port);
+        }
+        pipe(quitpipe[i]);
+    }
+
+    std::thread ts[nthreads];
+    for (int i = 0; i != nthreads; ++i) {
+        ts[i] = std::thread(server_thread, i, ls[i]);
+    }
+
+    clients(port, tamer::event<>());
+    tamer::loop();
+
+    for (int i = 0; i != nthreads; ++i) {
+        ssize_t w = write(quitpipe[i][1], "", 1);
+        (void) w;
+        ts[i].join();
+    }
+
+    int ndistinct = 0;
+    for (int i = 0; i != nthreads; ++i) {
+        bool distinct = drivers[i] && drivers[i] != tamer::driver::main;
+        for (int j = 0; j != i; ++j) {
+            distinct = distinct && drivers[i] != drivers[j];
+        }
+        ndistinct += distinct;
+    }
+    printf("served %d\n", nserved.load());
+    printf("drivers %d\n", ndistinct);
+    printf("signals refused %d\n", nsigrefused.load());
+    sige.trigger();
+    tamer::cleanup();
+}
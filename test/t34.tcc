@@ -0,0 +1,82 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <thread>
+#include <vector>
+#include <tamer/tamer.hh>
+
+// Trigger events from another thread with remote_event and driver::post.
+
+enum { nevents = 1000 };
+int order[nevents];
+int norder;
+
+void trigger_all(std::vector<tamer::remote_event>* v) {
+    for (auto& e : *v) {
+        e.trigger();
+    }
+}
+
+void post_then_trigger(tamer::driver* d, tamer::event<> e,
+                       tamer::remote_event* guard) {
+    d->post(std::move(e));
+    guard->trigger();
+}
+
+tamed void record(int i, tamer::event<> e) {
+    twait { e.at_trigger(make_event()); }
+    order[norder++] = i;
+}
+
+tamed void run() {
+    tvars {
+        std::vector<tamer::remote_event> v;
+        tamer::remote_event guard;
+        tamer::event<> e;
+        std::thread t;
+        int i, nordered = 0;
+    }
+    // the remote_events keep the loop alive until the thread triggers them
+    twait {
+        for (i = 0; i != nevents; ++i) {
+            e = make_event();
+            record(i, e);
+            v.emplace_back(std::move(e));
+        }
+        t = std::thread(trigger_all, &v);
+    }
+    t.join();
+    twait { tamer::at_asap(make_event()); }
+    for (i = 0; i != norder; ++i) {
+        nordered += order[i] == i;
+    }
+    printf("remote %d %d\n", norder, nordered);
+
+    // posts arrive in order and do not need a remote_event of their own
+    twait {
+        guard = tamer::remote_event(make_event());
+        t = std::thread(post_then_trigger, tamer::driver::main,
+                        make_event(), &guard);
+    }
+    t.join();
+    printf("posted\n");
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
@@ -0,0 +1,70 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <thread>
+#include <tamer/tamer.hh>
+#include <tamer/offload.hh>
+
+// Run work on the offload pool and collect the results as events.
+
+enum { ntasks = 100 };
+
+long sum_to(long n) {
+    long s = 0;
+    for (long i = 1; i <= n; ++i) {
+        s += i;
+    }
+    return s;
+}
+
+tamed void run() {
+    tvars {
+        long results[ntasks];
+        long nok = 0;
+        std::thread::id origin = std::this_thread::get_id(), worker;
+        int i;
+    }
+    twait {
+        for (i = 0; i != ntasks; ++i) {
+            tamer::offload([i] { return sum_to(i * 1000); },
+                           make_event(results[i]));
+        }
+    }
+    for (i = 0; i != ntasks; ++i) {
+        nok += results[i] == sum_to(i * 1000);
+    }
+    printf("offload %d %ld\n", ntasks, nok);
+
+    twait {
+        tamer::offload([&worker] { worker = std::this_thread::get_id(); },
+                       make_event());
+    }
+    printf("void %s\n", worker != origin ? "elsewhere" : "here");
+
+    results[0] = -1;
+    twait {
+        tamer::offload([]() -> long { throw 1; }, make_event(results[0]));
+    }
+    printf("threw %ld\n", results[0]);
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    tamer::initialize_offload(3);
+    run();
+    tamer::loop();
+    printf("%s\n", tamer::initialize_offload(1) ? "restart" : "started");
+    tamer::cleanup();
+}
@@ -0,0 +1,82 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <tamer/tamer.hh>
+
+// Timers in the timing wheel, from milliseconds to past the wheel's span,
+// fire in deadline order; cancelled timers never fire.
+
+enum { ntimers = 3000, ncancel = 1000 };
+unsigned seed = 1;
+timeval last;
+int nfired, ninorder, nlate, ncancelled;
+
+long random_usec() {
+    seed = seed * 1664525 + 1013904223U;
+    unsigned x = seed >> 8;
+    switch (x % 4) {
+    case 0:
+        return x % 300000;
+    case 1:
+        return (x % 70000) * 1000L;
+    case 2:
+        return (x % 72000) * 1000000L;
+    default:
+        return (x % 9000) * 1000000000L;
+    }
+}
+
+tamed void fire(timeval when) {
+    twait { tamer::at_time(when, make_event()); }
+    ++nfired;
+    ninorder += !timercmp(&when, &last, <);
+    nlate += timercmp(&tamer::recent(), &when, <);
+    last = when;
+}
+
+tamed void cancel(timeval when) {
+    tvars { tamer::rendezvous<> r; tamer::event<> e; }
+    e = make_event(r);
+    tamer::at_time(when, e);
+    e.trigger();
+    twait(r);
+    ++ncancelled;
+}
+
+int main(int, char**) {
+    tamer::initialize(tamer::init_tamer | tamer::init_timer_wheel);
+    tamer::set_time_type(tamer::time_virtual);
+    timeval base = tamer::recent();
+    for (int i = 0; i != ntimers + ncancel; ++i) {
+        long us = random_usec();
+        timeval when = base;
+        when.tv_sec += us / 1000000;
+        when.tv_usec += us % 1000000;
+        if (when.tv_usec >= 1000000) {
+            ++when.tv_sec;
+            when.tv_usec -= 1000000;
+        }
+        if (i % 4 == 3) {
+            cancel(when);
+        } else {
+            fire(when);
+        }
+    }
+    tamer::loop();
+    printf("fired %d inorder %d late %d\n", nfired, ninorder, nlate);
+    printf("cancelled %d\n", ncancelled);
+    printf("%s\n", last.tv_sec - base.tv_sec > 86400 * 50 ? "far" : "near");
+    tamer::cleanup();
+}
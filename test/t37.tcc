@@ -0,0 +1,71 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <tamer/tamer.hh>
+
+// Timers with slack fire within their windows, and timers whose windows
+// overlap share wakeups.
+
+enum { ntimers = 1000 };
+timeval last;
+int nfired, nearly, nlate, nwakeups;
+
+tamed void fire(int ms, int slack_ms, bool use_default) {
+    tvars { timeval when, limit, delta; }
+    delta.tv_sec = ms / 1000;
+    delta.tv_usec = (ms % 1000) * 1000;
+    timeradd(&tamer::recent(), &delta, &when);
+    // allow for the virtual clock's microsecond ticks
+    delta.tv_sec = 0;
+    delta.tv_usec = slack_ms * 1000 + 10;
+    timeradd(&when, &delta, &limit);
+    twait {
+        if (use_default) {
+            tamer::at_delay_msec(ms, make_event());
+        } else {
+            tamer::at_delay(ms / 1000., make_event(), false, slack_ms / 1000.);
+        }
+    }
+    ++nfired;
+    nearly += timercmp(&tamer::recent(), &when, <);
+    nlate += timercmp(&tamer::recent(), &limit, >);
+    nwakeups += timercmp(&tamer::recent(), &last, !=);
+    last = tamer::recent();
+}
+
+void run(const char* what, int slack_ms, bool use_default) {
+    nfired = nearly = nlate = nwakeups = 0;
+    tamer::set_timer_slack(use_default ? slack_ms / 1000. : 0);
+    for (int i = 1; i <= ntimers; ++i) {
+        fire(i, slack_ms, use_default);
+    }
+    tamer::loop();
+    int maxwakeups = slack_ms ? ntimers / (slack_ms + 1) + 10 : ntimers;
+    printf("%s: fired %d early %d late %d %s\n",
+           what, nfired, nearly, nlate,
+           nwakeups <= maxwakeups ? "wakeups ok" : "too many wakeups");
+}
+
+int main(int argc, char** argv) {
+    bool wheel = argc > 1 && strcmp(argv[1], "-w") == 0;
+    tamer::initialize(tamer::init_tamer | (wheel ? tamer::init_timer_wheel : 0));
+    tamer::set_time_type(tamer::time_virtual);
+    last = tamer::recent();
+    run("exact", 0, false);
+    run("slack", 10, false);
+    run("default", 4, true);
+    tamer::cleanup();
+}
@@ -0,0 +1,76 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <tamer/tamer.hh>
+
+// Many fds ready at once are delivered in few loop iterations, and a full
+// epoll batch is counted. After a long run of nearly empty waits the batch
+// shrinks again, so a second, smaller burst fills it once more.
+
+int nread;
+bool idle_done;
+
+tamed void reader(int fd) {
+    twait { tamer::at_fd_read(fd, make_event()); }
+    ++nread;
+    close(fd);
+}
+
+tamed void idle(int n) {
+    while (n-- > 0) {
+        twait { tamer::at_asap(make_event()); }
+    }
+    idle_done = true;
+}
+
+static bool burst(int npipes) {
+    nread = 0;
+    for (int i = 0; i != npipes; ++i) {
+        int p[2];
+        if (pipe(p) != 0) {
+            perror("pipe");
+            return false;
+        }
+        reader(p[0]);
+        ssize_t w = write(p[1], "x", 1);
+        (void) w;
+        close(p[1]);
+    }
+    int rounds = 0;
+    while (nread != npipes) {
+        tamer::once();
+        ++rounds;
+    }
+    printf("read %d rounds %d\n", nread, rounds);
+    printf("saturations %llu\n", (unsigned long long)
+           tamer::driver::main->stats().poll_saturations);
+    return true;
+}
+
+int main(int, char**) {
+    tamer::initialize(tamer::init_tamer);
+    if (!burst(300)) {
+        return 1;
+    }
+    idle(300);
+    while (!idle_done) {
+        tamer::once();
+    }
+    if (!burst(200)) {
+        return 1;
+    }
+    tamer::cleanup();
+}
@@ -0,0 +1,92 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <vector>
+#include <tamer/tamer.hh>
+
+// Driver statistics count timers, blocked closures, fds, and events.
+
+tamed void reader(int fd) {
+    tvars { char buf[1]; }
+    twait { tamer::at_fd_read(fd, make_event()); }
+    if (read(fd, buf, 1) == 1) {
+        printf("read\n");
+    }
+}
+
+tamed void writer(int fd) {
+    twait { tamer::at_delay(0.050, make_event()); }
+    ssize_t w = write(fd, "x", 1);
+    (void) w;
+}
+
+void handler(tamer::driver* d, const tamer::driver_stats& s) {
+    printf("handler closures %u fds %u asap %u\n",
+           s.closures_blocked, s.fds, s.asap);
+    d->set_stats_handler(nullptr, 0);
+}
+
+// Installing the handler once this closure has resumed keeps the count
+// independent of which timer the driver happens to fire first.
+tamed void sleeper() {
+    twait { tamer::at_delay(0.001, make_event()); }
+    tamer::driver::main->set_stats_handler(handler, 0.002);
+}
+
+tamed void culler() {
+    tvars { tamer::event<> e; }
+    twait {
+        e = make_event();
+        tamer::at_delay(0.010, e);
+        e.trigger();
+    }
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    int p[2];
+    if (pipe(p) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    reader(p[0]);
+    writer(p[1]);
+    sleeper();
+    culler();
+    tamer::loop();
+    tamer::driver_stats s = tamer::driver::main->stats();
+    printf("pushed %llu fired %llu culled %llu\n",
+           (unsigned long long) s.timers_pushed,
+           (unsigned long long) s.timers_fired,
+           (unsigned long long) s.timers_culled);
+    printf("loops %s blocked %s\n", s.loops > 0 ? "ok" : "none",
+           s.blocked_nsec > 0 ? "ok" : "none");
+
+    unsigned live = s.events_live;
+    {
+        tamer::rendezvous<> r;
+        std::vector<tamer::event<> > es;
+        for (int i = 0; i != 100; ++i) {
+            es.push_back(tamer::make_event(r));
+        }
+        s = tamer::driver::main->stats();
+        printf("events %u peak %s\n", s.events_live - live,
+               s.events_peak >= s.events_live ? "ok" : "bad");
+    }
+    s = tamer::driver::main->stats();
+    printf("events %u\n", s.events_live - live);
+    tamer::cleanup();
+}
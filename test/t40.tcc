@@ -0,0 +1,57 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <tamer/tamer.hh>
+
+// The closure profiler counts activations by twait location.
+
+tamed void ticker(int n) {
+    tvars { int i; }
+    for (i = 0; i != n; ++i) {
+        twait { tamer::at_asap(make_event()); }
+    }
+}
+
+tamed void sleeper() {
+    twait { tamer::at_delay(0.001, make_event()); }
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    tamer::driver::main->set_closure_profiling(true);
+    ticker(10);
+    sleeper();
+    tamer::loop();
+    tamer::driver::main->set_closure_profiling(false);
+    ticker(5);
+    tamer::loop();
+
+    std::vector<tamer::closure_profile_entry> x;
+    tamer::driver::main->closure_profile(x);
+    std::sort(x.begin(), x.end(),
+              [](const tamer::closure_profile_entry& a,
+                 const tamer::closure_profile_entry& b) {
+                  return a.location < b.location;
+              });
+    for (auto& e : x) {
+        const char* slash = strrchr(e.location.c_str(), '/');
+        printf("%s %llu%s\n", slash ? slash + 1 : e.location.c_str(),
+               (unsigned long long) e.count,
+               e.max_nsec <= e.nsec ? "" : " bad");
+    }
+    tamer::cleanup();
+}
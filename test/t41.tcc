@@ -0,0 +1,65 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <tamer/tamer.hh>
+
+// The loop latency histogram and the stall detector see a long closure.
+
+void spin(double sec) {
+    uint64_t start = tamer::now_nsec();
+    while (tamer::now_nsec() - start < uint64_t(sec * 1e9)) {
+    }
+}
+
+tamed void quick(int n) {
+    tvars { int i; }
+    for (i = 0; i != n; ++i) {
+        twait { tamer::at_asap(make_event()); }
+    }
+}
+
+tamed void slow() {
+    twait { tamer::at_delay(0.001, make_event()); }
+    spin(0.02);
+    twait { tamer::at_delay(0.001, make_event()); }
+}
+
+int nstalls;
+
+void stalled(tamer::driver*, uint64_t nsec,
+             const std::vector<tamer::closure_profile_entry>& ran) {
+    ++nstalls;
+    const char* loc = ran.empty() ? "none" : ran[0].location.c_str();
+    const char* slash = strrchr(loc, '/');
+    printf("stall %s %s\n", nsec >= 20000000 ? "long" : "short",
+           slash ? slash + 1 : loc);
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    tamer::driver::main->set_stall_threshold(0.010, stalled);
+    quick(20);
+    slow();
+    tamer::loop();
+    const tamer::latency_histogram& h = tamer::driver::main->loop_latency();
+    printf("stalls %d\n", nstalls);
+    printf("samples %s\n", h.count() != 0 ? "ok" : "none");
+    printf("max %s p100 %s p50 %s\n",
+           h.max() >= 20000000 ? "ok" : "short",
+           h.percentile(1) == h.max() ? "ok" : "bad",
+           h.percentile(0.5) <= h.percentile(1) ? "ok" : "bad");
+    tamer::cleanup();
+}
@@ -0,0 +1,124 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// Uncontended mutex::acquire and fd::read/fd::write complete before they
+// return; contended and partial ones wait, then finish in order.
+
+tamed void test_mutex(tamer::event<> done) {
+    tvars {
+        tamer::mutex m;
+        tamer::rendezvous<int> r;
+        tamer::event<> e[3];
+        int id;
+    }
+
+    e[0] = make_event(r, 0);
+    m.acquire(e[0]);
+    printf("mutex uncontended %s\n", e[0] ? "waiting" : "acquired");
+
+    e[1] = make_event(r, 1);
+    m.acquire(e[1]);
+    e[2] = make_event(r, 2);
+    m.acquire_shared(e[2]);
+    printf("mutex contended %s %s try %d\n", e[1] ? "waiting" : "acquired",
+           e[2] ? "waiting" : "acquired", m.try_acquire());
+
+    twait(r, id);
+    printf("mutex got %d\n", id);
+    m.release();
+    twait(r, id);
+    printf("mutex got %d\n", id);
+    m.release();
+    twait(r, id);
+    printf("mutex got %d\n", id);
+    m.release_shared();
+
+    printf("mutex try %d %d\n", m.try_acquire(), m.try_acquire());
+    m.release();
+    done();
+}
+
+tamed void test_fd(tamer::event<> done) {
+    tvars {
+        tamer::fd rfd, wfd;
+        tamer::rendezvous<int> r;
+        tamer::event<int> e[3];
+        char buf[16], buf2[16];
+        size_t n[3];
+        int ret[3], id;
+    }
+
+    tamer::fd::pipe(rfd, wfd);
+
+    e[0] = make_event(r, 0, ret[0]);
+    wfd.write("hello", 5, n[0], e[0]);
+    e[1] = make_event(r, 1, ret[1]);
+    rfd.read(buf, 5, n[1], e[1]);
+    printf("fd uncontended write %s read %s %zu %.5s\n",
+           e[0] ? "waiting" : "done", e[1] ? "waiting" : "done", n[1], buf);
+    twait(r, id);
+    twait(r, id);
+
+    // a partial read continues in the background
+    memset(buf, 0, sizeof(buf));
+    wfd.write("abc", 3, n[0], make_event(r, 0, ret[0]));
+    twait(r, id);
+    e[1] = make_event(r, 1, ret[1]);
+    rfd.read(buf, 6, n[1], e[1]);
+    printf("fd partial %s %zu\n", e[1] ? "waiting" : "done", n[1]);
+    wfd.write("def", 3, n[0], make_event(r, 0, ret[0]));
+    twait(r, id);
+    twait(r, id);
+    printf("fd partial %d %zu %s\n", ret[1], n[1], buf);
+
+    // a read waiting for data holds the read lock; a second read queues
+    memset(buf, 0, sizeof(buf));
+    e[1] = make_event(r, 1, ret[1]);
+    rfd.read(buf, 4, n[1], e[1]);
+    e[2] = make_event(r, 2, ret[2]);
+    rfd.read(buf2, 4, n[2], e[2]);
+    printf("fd contended %s %s\n", e[1] ? "waiting" : "done",
+           e[2] ? "waiting" : "done");
+    wfd.write("12345678", 8, n[0], make_event(r, 0, ret[0]));
+    twait(r, id);
+    twait(r, id);
+    printf("fd got %d %.4s\n", id, id == 1 ? buf : buf2);
+    twait(r, id);
+    printf("fd got %d %.4s\n", id, id == 1 ? buf : buf2);
+
+    // end of file completes immediately
+    wfd.close();
+    e[1] = make_event(r, 1, ret[1]);
+    rfd.read(buf, 4, n[1], e[1]);
+    printf("fd eof %s %d %zu\n", e[1] ? "waiting" : "done", ret[1], n[1]);
+    twait(r, id);
+    done();
+}
+
+tamed void run() {
+    twait { test_mutex(make_event()); }
+    twait { test_fd(make_event()); }
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
@@ -0,0 +1,48 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <string>
+#include <tamer/tamer.hh>
+
+// Closure layout: hot variables, reordered scalars, and size reports.
+// This test is compiled with --report-closure-sizes.
+
+tamed [hot(n, total)] void summer(bool verbose, int n, std::string label,
+                                  tamer::event<long> done) {
+    tvars { char c = 'a'; long total = 0; short k; int i; std::string s; }
+    for (i = 0; i != n; ++i) {
+        twait { tamer::at_asap(make_event()); }
+        total += i;
+        s += c;
+    }
+    k = s.size();
+    if (verbose) {
+        printf("%s %d %ld %s %d\n", label.c_str(), n, total, s.c_str(), k);
+    }
+    done.trigger(total);
+}
+
+tamed void main_loop() {
+    tvars { long r = 0; }
+    twait { summer(true, 5, "sum", make_event(r)); }
+    printf("r %ld\n", r);
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    main_loop();
+    tamer::loop();
+    tamer::cleanup();
+}
@@ -0,0 +1,151 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <tamer/tamer.hh>
+
+// Tamed functions compiled with --coroutines. A shared_ptr passed to a
+// tamed function counts how many coroutine frames are still alive.
+
+tamed template <typename T>
+void doubler(T x, tamer::event<T> e) {
+    twait { tamer::at_asap(make_event()); }
+    e.trigger(x + x);
+}
+
+tamed void summer(int n, std::shared_ptr<int> frames, tamer::event<int> done) {
+    tvars { int i, sum = 0, x (); std::string s("x"); }
+    for (i = 0; i != n; ++i) {
+        twait { doubler(i, make_event(x)); }
+        sum += x;
+        s += "y";
+    }
+    printf("summer %d %s frames %ld\n", sum, s.c_str(), frames.use_count());
+    done.trigger(sum);
+}
+
+tamed void early(int x, tamer::event<> done) {
+    twait { tamer::at_asap(make_event()); }
+    if ([](int y) { return y * 2; }(x) > 10) {
+        printf("early return\n");
+        done.trigger();
+        return;
+    }
+    printf("late return\n");
+    done.trigger();
+}
+
+tamed void explicit_waiter(tamer::rendezvous<int>& r, tamer::event<> done) {
+    tvars { int which = 0; }
+    while (r.has_events()) {
+        twait(r, which);
+        printf("explicit %d\n", which);
+    }
+    done.trigger();
+}
+
+tamed void defaults(tamer::event<int> e, int, int b = 2) {
+    twait { tamer::at_asap(make_event()); }
+    e.trigger(b);
+}
+
+// no twait, so this stays a plain function
+tamed void immediate(int x, tamer::event<int> e) {
+    e.trigger(x + 1);
+}
+
+class waiter : public tamer::tamed_class {
+  public:
+    waiter(int id)
+        : id_(id) {
+    }
+    tamed void wait(std::shared_ptr<int> frames, tamer::event<> e);
+    tamed void guarded(tamer::event<> e);
+  private:
+    int id_;
+};
+
+tamed void waiter::wait(std::shared_ptr<int> frames, tamer::event<> e) {
+    twait { tamer::at_delay_msec(10000, make_event()); }
+    printf("waiter %d woke\n", id_);
+    e.trigger();
+}
+
+tamed void waiter::guarded(tamer::event<> e) {
+    tvars { tamer::destroy_guard guard(this); }
+    twait { tamer::at_asap(make_event()); }
+    printf("guarded %d\n", id_);
+    delete this;
+    e.trigger();
+}
+
+tamed void orphan(std::shared_ptr<int> frames) {
+    tvars { tamer::rendezvous<> r; }
+    twait(r);
+    printf("orphan woke\n");
+}
+
+tamed void main_loop(std::shared_ptr<int> frames) {
+    tvars {
+        int r = 0;
+        double d = 0;
+        tamer::rendezvous<int> er;
+        tamer::event<> e0, e1;
+        waiter* w;
+    }
+    twait { summer(4, frames, make_event(r)); }
+    printf("r %d frames %ld\n", r, frames.use_count());
+
+    twait { early(2, make_event()); }
+    twait { early(20, make_event()); }
+
+    e0 = make_event(er, 0);
+    e1 = make_event(er, 1);
+    twait {
+        explicit_waiter(er, make_event());
+        tamer::at_asap(e1);
+        tamer::at_delay_msec(1, e0);
+    }
+
+    twait { doubler(1.25, make_event(d)); }
+    printf("doubler %g\n", d);
+    twait { defaults(make_event(r), 0); }
+    printf("defaults %d\n", r);
+    twait { immediate(6, make_event(r)); }
+    printf("immediate %d\n", r);
+
+    // destroying a tamed_class kills its blocked coroutines
+    w = new waiter(1);
+    w->wait(frames, tamer::event<>());
+    twait { tamer::at_asap(make_event()); }
+    printf("before delete frames %ld\n", frames.use_count());
+    delete w;
+    twait { tamer::at_asap(make_event()); }
+    printf("after delete frames %ld\n", frames.use_count());
+
+    twait { (new waiter(2))->guarded(make_event()); }
+    orphan(frames);
+    printf("done frames %ld\n", frames.use_count());
+}
+
+int main(int, char**) {
+    std::shared_ptr<int> frames = std::make_shared<int>(0);
+    tamer::initialize();
+    main_loop(frames);
+    tamer::loop();
+    tamer::cleanup();
+    printf("cleanup frames %ld\n", frames.use_count());
+}
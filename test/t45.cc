@@ -0,0 +1,125 @@
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <tamer/coro.hh>
+
+// Plain C++20 coroutines awaiting Tamer events, without the preprocessor.
+// A shared_ptr passed to a task counts how many task frames are alive.
+
+tamer::task squares(int n, tamer::event<int> done) {
+    int sum = 0;
+    for (int i = 0; i != n; ++i) {
+        co_await tamer::asap();
+        sum += i * i;
+    }
+    done.trigger(sum);
+}
+
+tamer::task explicit_waiter(tamer::rendezvous<int>& r, tamer::event<> done) {
+    while (r.has_events()) {
+        int which = co_await r;
+        printf("explicit %d\n", which);
+    }
+    done.trigger();
+}
+
+tamer::task pipe_test(tamer::event<> done) {
+    tamer::fd rfd, wfd;
+    tamer::fd::pipe(rfd, wfd);
+    char buf[6];
+    size_t n = 0;
+    int ret = co_await tamer::write(wfd, std::string("hello"));
+    printf("write %d\n", ret);
+    ret = co_await tamer::read(rfd, buf, 5, n);
+    buf[n] = 0;
+    printf("read %d %zu %s\n", ret, n, buf);
+    wfd.close();
+    ret = co_await tamer::read_once(rfd, buf, 5, n);
+    printf("eof %d %zu\n", ret, n);
+    done.trigger();
+}
+
+class waiter : public tamer::tamed_class {
+  public:
+    tamer::task wait(std::shared_ptr<int> frames) {
+        co_await tamer::delay(10);
+        printf("waiter woke\n");
+    }
+};
+
+tamer::task orphan(std::shared_ptr<int> frames) {
+    tamer::rendezvous<> r;
+    co_await r;
+    printf("orphan woke\n");
+}
+
+tamer::task main_loop(std::shared_ptr<int> frames) {
+    int r = co_await tamer::await<int>([](tamer::event<int> e) {
+            squares(4, std::move(e));
+        });
+    printf("squares %d\n", r);
+
+    tamer::rendezvous<int> er;
+    tamer::event<> e0 = tamer::make_event(er, 0), e1 = tamer::make_event(er, 1);
+    co_await tamer::await<>([&](tamer::event<> e) {
+            explicit_waiter(er, std::move(e));
+            tamer::at_asap(e1);
+            tamer::at_delay_msec(1, e0);
+        });
+
+    // events triggered during the call do not suspend
+    auto [x, y] = co_await tamer::await<int, std::string>(
+        [](tamer::event<int, std::string> e) {
+            e.trigger(2, "two");
+        });
+    printf("sync %d %s\n", x, y.c_str());
+
+    tamer::rendezvous<> zr;
+    tamer::at_asap(tamer::make_event(zr));
+    co_await zr;
+    printf("zero\n");
+
+    tamer::gather_rendezvous gr;
+    tamer::at_asap(tamer::make_event(gr));
+    tamer::at_delay_msec(1, tamer::make_event(gr));
+    co_await gr;
+    printf("gather %d\n", gr.has_waiting());
+
+    co_await tamer::await<>([&](tamer::event<> e) {
+            pipe_test(std::move(e));
+        });
+
+    // destroying a tamed_class kills its blocked tasks
+    waiter* w = new waiter;
+    w->wait(frames);
+    co_await tamer::asap();
+    printf("before delete frames %ld\n", frames.use_count());
+    delete w;
+    co_await tamer::asap();
+    printf("after delete frames %ld\n", frames.use_count());
+
+    orphan(frames);
+    printf("done frames %ld\n", frames.use_count());
+}
+
+int main(int, char**) {
+    std::shared_ptr<int> frames = std::make_shared<int>(0);
+    tamer::initialize();
+    main_loop(frames);
+    tamer::loop();
+    tamer::cleanup();
+    printf("cleanup frames %ld\n", frames.use_count());
+}
@@ -0,0 +1,143 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// fd::sendfile and fd::splice, with transfers larger than socket buffers.
+
+enum { file_size = 200000 };
+std::string contents;
+
+void make_socketpair(tamer::fd& a, tamer::fd& b) {
+    int sv[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    tamer::fd::make_nonblocking(sv[0]);
+    tamer::fd::make_nonblocking(sv[1]);
+    a = tamer::fd(sv[0]);
+    b = tamer::fd(sv[1]);
+}
+
+tamed void source(tamer::fd f, std::string data) {
+    twait { f.write(data, make_event()); }
+    f.close();
+}
+
+tamed void close_later(tamer::fd f, int msec) {
+    twait { tamer::at_delay_msec(msec, make_event()); }
+    f.close();
+}
+
+tamed void send_file(tamer::fd f, tamer::fd file, off_t offset, size_t size,
+                     tamer::event<int, size_t> done) {
+    tvars { int ret; size_t n; }
+    twait { f.sendfile(file, offset, size, n, make_event(ret)); }
+    f.close();
+    done(ret, n);
+}
+
+tamed void proxy(tamer::fd f, tamer::fd src, size_t size,
+                 tamer::event<int, size_t> done) {
+    tvars { int ret; size_t n; }
+    twait { f.splice(src, size, n, make_event(ret)); }
+    f.close();
+    done(ret, n);
+}
+
+tamed void run(tamer::fd file) {
+    tvars {
+        tamer::fd a, b, c, d;
+        std::string buf = std::string(file_size + 1, 0);
+        size_t n, got;
+        int ret;
+    }
+
+    // reads stop at end-of-file, so each read's size is an upper bound
+    make_socketpair(a, b);
+    twait {
+        b.read(&buf[0], buf.size(), got, make_event());
+        send_file(a, file, 1000, 150000, make_event(ret, n));
+    }
+    printf("sendfile %d %zu got %zu %s\n", ret, n, got,
+           buf.compare(0, got, contents, 1000, 150000) ? "bad" : "ok");
+
+    make_socketpair(a, b);
+    twait {
+        b.read(&buf[0], buf.size(), got, make_event());
+        send_file(a, file, 190000, 50000, make_event(ret, n));
+    }
+    printf("sendfile past end %d %zu got %zu %s\n", ret, n, got,
+           buf.compare(0, got, contents, 190000, 10000) ? "bad" : "ok");
+
+    // proxy between two socket pairs until end-of-file
+    make_socketpair(a, b);
+    make_socketpair(c, d);
+    source(a, contents);
+    twait {
+        d.read(&buf[0], buf.size(), got, make_event());
+        proxy(c, b, (size_t) -1, make_event(ret, n));
+    }
+    printf("splice %d %zu got %zu %s\n", ret, n, got,
+           buf.compare(0, got, contents) ? "bad" : "ok");
+
+    // a bounded splice leaves the rest in the source
+    make_socketpair(a, b);
+    make_socketpair(c, d);
+    twait {
+        a.write(contents.substr(0, 1000), make_event());
+        d.read(&buf[0], buf.size(), got, make_event());
+        proxy(c, b, 600, make_event(ret, n));
+    }
+    printf("splice bounded %d %zu got %zu\n", ret, n, got);
+    a.close();
+    twait { b.read(&buf[0], buf.size(), got, make_event()); }
+    printf("remaining %zu %s\n", got,
+           buf.compare(0, got, contents, 600, 400) ? "bad" : "ok");
+
+    // closing the source partway cancels the transfer
+    make_socketpair(a, b);
+    make_socketpair(c, d);
+    twait {
+        a.write(contents.substr(0, 100), make_event());
+        d.read(&buf[0], 100, got, make_event());
+        proxy(c, b, 1000, make_event(ret, n));
+        close_later(b, 20);
+    }
+    printf("splice source closed %d %zu got %zu\n", ret, n, got);
+}
+
+int main(int, char**) {
+    char name[] = "/tmp/tamer-t46-XXXXXX";
+    int f = mkstemp(name);
+    if (f < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    unlink(name);
+    for (size_t i = 0; i != file_size; ++i) {
+        contents += char('a' + i % 23);
+    }
+    if (write(f, contents.data(), contents.length()) != (ssize_t) contents.length()) {
+        perror("write");
+        return 1;
+    }
+    tamer::initialize();
+    run(tamer::fd(f));
+    tamer::loop();
+    tamer::cleanup();
+}
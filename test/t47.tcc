@@ -0,0 +1,116 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <assert.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// fd::write_zerocopy over TCP, where it may use MSG_ZEROCOPY, and over
+// other sockets, where it falls back to fd::write.
+
+tamed void source(tamer::fd f, const std::string& buf, int nwrites,
+                  tamer::event<> done) {
+    tvars { int i, ret; size_t n, total = 0; bool ok = true; }
+    for (i = 0; i != nwrites; ++i) {
+        twait { f.write_zerocopy(buf.data(), buf.length(), n, make_event(ret)); }
+        ok = ok && ret == 0 && n == buf.length();
+        total += n;
+    }
+    printf("wrote %zu %s\n", total, ok ? "ok" : "failed");
+    f.close();
+    done();
+}
+
+// the reader expects nwrites copies of buf, then end-of-file
+tamed void check(tamer::fd f, const std::string& buf, int nwrites,
+                 tamer::event<size_t> done) {
+    tvars { std::string got; size_t n; int i; bool ok = true; }
+    got.resize(buf.length() * nwrites + 1);
+    twait { f.read(&got[0], got.length(), n, make_event()); }
+    for (i = 0; i != nwrites && ok; ++i) {
+        ok = got.compare(i * buf.length(), buf.length(), buf) == 0;
+    }
+    if (!ok) {
+        printf("bad data\n");
+    }
+    done(n);
+}
+
+tamed void run(tamer::fd listenfd, struct in_addr addr, int port) {
+    tvars {
+        tamer::fd a, b;
+        std::string big, small;
+        size_t got, i;
+        int sv[2];
+    }
+
+    for (i = 0; i != 920000; ++i) {
+        big += char('a' + i % 23);
+    }
+    small = big.substr(0, 230);
+
+    twait {
+        tamer::tcp_connect(addr, port, make_event(a));
+        listenfd.accept(make_event(b));
+    }
+    assert(a && b);
+    twait {
+        check(b, big, 4, make_event(got));
+        source(a, big, 4, make_event());
+    }
+    printf("tcp got %zu\n", got);
+
+    twait {
+        tamer::tcp_connect(addr, port, make_event(a));
+        listenfd.accept(make_event(b));
+    }
+    twait {
+        check(b, small, 3, make_event(got));
+        source(a, small, 3, make_event());
+    }
+    printf("tcp small got %zu\n", got);
+
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    tamer::fd::make_nonblocking(sv[0]);
+    tamer::fd::make_nonblocking(sv[1]);
+    a = tamer::fd(sv[0]);
+    b = tamer::fd(sv[1]);
+    twait {
+        check(b, big, 2, make_event(got));
+        source(a, big, 2, make_event());
+    }
+    printf("unix got %zu\n", got);
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    signal(SIGPIPE, SIG_IGN);
+
+    tamer::fd listenfd = tamer::tcp_listen(0);
+    assert(listenfd);
+    struct sockaddr_in saddr;
+    socklen_t saddr_len = sizeof(saddr);
+    int r = getsockname(listenfd.fdnum(), (struct sockaddr*) &saddr, &saddr_len);
+    assert(r == 0);
+    saddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    run(listenfd, saddr.sin_addr, ntohs(saddr.sin_port));
+    tamer::loop();
+    tamer::cleanup();
+}
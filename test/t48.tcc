@@ -0,0 +1,129 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <assert.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// fd::recvmmsg and fd::sendmmsg over UDP loopback.
+
+tamer::fd udp_bind(struct sockaddr_in& saddr) {
+    tamer::fd f = tamer::fd::socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&saddr, 0, sizeof(saddr));
+    saddr.sin_family = AF_INET;
+    saddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int r = f.bind((struct sockaddr*) &saddr, sizeof(saddr));
+    assert(r == 0);
+    socklen_t len = sizeof(saddr);
+    r = getsockname(f.fdnum(), (struct sockaddr*) &saddr, &len);
+    assert(r == 0);
+    return f;
+}
+
+tamed void receive(tamer::fd f, size_t count, tamer::event<> done) {
+    tvars { std::vector<tamer::datagram> dgs; int ret = 0, ncalls = 0; size_t i; bool ok = true; }
+    while (dgs.size() < count && ret == 0) {
+        twait { f.recvmmsg(dgs, count - dgs.size(), make_event(ret)); }
+        ++ncalls;
+    }
+    for (i = 0; i != dgs.size(); ++i) {
+        ok = ok && dgs[i].data == "packet " + std::to_string(i)
+            && dgs[i].addrlen == sizeof(struct sockaddr_in)
+            && dgs[i].segment_size == 0;
+    }
+    printf("received %d %zu %s%s\n", ret, dgs.size(), ok ? "ok" : "bad",
+           ncalls < int(count) ? " batched" : "");
+    done();
+}
+
+tamed void run() {
+    tvars {
+        struct sockaddr_in raddr, saddr, gaddr;
+        tamer::fd r = udp_bind(raddr), s = udp_bind(saddr), g = udp_bind(gaddr);
+        std::vector<tamer::datagram> dgs;
+        size_t nsent, i, total;
+        int ret, one = 1;
+    }
+
+    for (i = 0; i != 100; ++i) {
+        dgs.emplace_back("packet " + std::to_string(i),
+                         (struct sockaddr*) &raddr, sizeof(raddr));
+    }
+    twait { s.sendmmsg(dgs, nsent, make_event(ret)); }
+    printf("sent %d %zu\n", ret, nsent);
+    twait { receive(r, 100, make_event()); }
+
+    // a receiver waiting first is woken by the sender
+    twait {
+        receive(r, 100, make_event());
+        s.sendmmsg(dgs, nsent, make_event(ret));
+    }
+
+    // GSO splits one buffer into several datagrams
+    dgs.clear();
+    dgs.emplace_back(std::string(2500, 'x'), (struct sockaddr*) &raddr,
+                     sizeof(raddr), 1000);
+    twait { s.sendmmsg(dgs, nsent, make_event(ret)); }
+    printf("sent gso %d %zu\n", ret, nsent);
+    dgs.clear();
+    while (dgs.size() < 3) {
+        twait { r.recvmmsg(dgs, 3, make_event(ret)); }
+    }
+    printf("received gso %zu %zu %zu\n", dgs[0].data.size(),
+           dgs[1].data.size(), dgs[2].data.size());
+
+    // with UDP_GRO on, a small size still fits a coalesced batch
+    setsockopt(g.fdnum(), IPPROTO_UDP, UDP_GRO, &one, sizeof(one));
+    dgs.clear();
+    dgs.emplace_back(std::string(2500, 'x'), (struct sockaddr*) &gaddr,
+                     sizeof(gaddr), 1000);
+    twait { s.sendmmsg(dgs, nsent, make_event(ret)); }
+    dgs.clear();
+    total = 0;
+    while (total < 2500 && dgs.size() < 3) {
+        twait { g.recvmmsg(dgs, 3, 100, make_event(ret)); }
+        for (total = i = 0; i != dgs.size(); ++i) {
+            total += dgs[i].data.size();
+        }
+    }
+    printf("received gro %d %zu\n", ret, total);
+
+    // datagrams longer than the requested size are truncated
+    dgs.clear();
+    dgs.emplace_back("truncated", (struct sockaddr*) &raddr, sizeof(raddr));
+    twait { s.sendmmsg(dgs, nsent, make_event(ret)); }
+    dgs.clear();
+    twait { r.recvmmsg(dgs, 10, 5, make_event(ret)); }
+    printf("received short %d %zu %s\n", ret, dgs.size(), dgs[0].data.c_str());
+
+    // a closed fd cancels a waiting receive
+    dgs.clear();
+    twait {
+        r.recvmmsg(dgs, 10, make_event(ret));
+        r.close();
+    }
+    printf("closed %d %zu\n", ret, dgs.size());
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
@@ -0,0 +1,161 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// fd::accept_many and accept_control.
+
+struct in_addr loopback;
+int port;
+std::vector<tamer::fd> clients;
+
+tamed void connect_clients(int n, tamer::event<> done) {
+    tvars { tamer::rendezvous<> r; std::vector<tamer::fd> fds; int i; }
+    fds.resize(n);
+    for (i = 0; i != n; ++i) {
+        tamer::tcp_connect(loopback, port, make_event(r, fds[i]));
+    }
+    twait(r);
+    for (i = 0; i != n; ++i) {
+        assert(fds[i]);
+        clients.push_back(fds[i]);
+    }
+    done();
+}
+
+bool flags_ok(const std::vector<tamer::fd>& fds) {
+    for (auto& f : fds) {
+        if (!(fcntl(f.fdnum(), F_GETFL) & O_NONBLOCK)
+            || !(fcntl(f.fdnum(), F_GETFD) & FD_CLOEXEC)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+tamed void run(tamer::fd listenfd) {
+    tvars {
+        std::vector<tamer::fd> out;
+        int ret, base;
+        tamer::rendezvous<> pending;
+        tamer::accept_control* control;
+    }
+
+    twait { connect_clients(5, make_event()); }
+    twait { listenfd.accept_many(64, out, make_event(ret)); }
+    printf("batch %d %zu %s\n", ret, out.size(), flags_ok(out) ? "flags ok" : "bad flags");
+
+    out.clear();
+    twait { connect_clients(5, make_event()); }
+    twait { listenfd.accept_many(2, out, make_event(ret)); }
+    printf("limited %d %zu\n", ret, out.size());
+    twait { listenfd.accept_many(64, out, make_event(ret)); }
+    printf("rest %d %zu\n", ret, out.size());
+
+    // a waiting accept_many wakes for a new connection
+    out.clear();
+    twait {
+        listenfd.accept_many(64, out, make_event(ret));
+        connect_clients(1, make_event());
+    }
+    printf("waited %d %zu\n", ret, out.size());
+
+    // at most three live connections
+    out.clear();
+    control = new tamer::accept_control(3);
+    twait { connect_clients(5, make_event()); }
+    twait { listenfd.accept_many(64, out, *control, make_event(ret)); }
+    printf("max_live %d %zu live %zu\n", ret, out.size(), control->live());
+    listenfd.accept_many(64, out, *control, make_event(pending, ret));
+    twait { tamer::at_delay_msec(10, make_event()); }
+    printf("refused %zu\n", out.size());
+    out[0].close();
+    twait(pending);
+    printf("after close %d %zu live %zu\n", ret, out.size(), control->live());
+    out.clear();
+    printf("cleared live %zu\n", control->live());
+    twait { listenfd.accept_many(64, out, *control, make_event(ret)); }
+    printf("drained %d %zu live %zu\n", ret, out.size(), control->live());
+    out.clear();
+    delete control;
+
+    // descriptor headroom
+    twait { connect_clients(5, make_event()); }
+    base = dup(0);
+    close(base);
+    tamer::fd::open_limit(base + 10);
+    control = new tamer::accept_control(0, 8);
+    twait { listenfd.accept_many(64, out, *control, make_event(ret)); }
+    printf("headroom %d %zu\n", ret, out.size());
+    out[1].close();
+    twait { listenfd.accept_many(64, out, *control, make_event(ret)); }
+    printf("headroom after close %d %zu\n", ret, out.size());
+    out.clear();
+    twait { listenfd.accept_many(64, out, *control, make_event(ret)); }
+    printf("headroom drained %d %zu\n", ret, out.size());
+    out.clear();
+    delete control;
+
+    // EMFILE pauses instead of failing
+    twait { connect_clients(2, make_event()); }
+    base = dup(0);
+    close(base);
+    tamer::fd::open_limit(base + 1);
+    control = new tamer::accept_control(0, 0);
+    twait { listenfd.accept_many(64, out, *control, make_event(ret)); }
+    printf("emfile %d %zu\n", ret, out.size());
+    listenfd.accept_many(64, out, *control, make_event(pending, ret));
+    twait { tamer::at_delay_msec(100, make_event()); }
+    printf("emfile paused %zu\n", out.size());
+    tamer::fd::open_limit(base + 100);
+    twait(pending);
+    printf("emfile resumed %d %zu\n", ret, out.size());
+    out.clear();
+    delete control;
+
+    // without a control, EMFILE is an error
+    twait { connect_clients(1, make_event()); }
+    base = dup(0);
+    close(base);
+    tamer::fd::open_limit(base);
+    twait { listenfd.accept_many(64, out, make_event(ret)); }
+    printf("no control %d %zu\n", ret, out.size());
+    tamer::fd::open_limit(base + 100);
+    listenfd.close();
+    clients.clear();
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    tamer::fd listenfd = tamer::tcp_listen(0);
+    assert(listenfd);
+    struct sockaddr_in saddr;
+    socklen_t saddr_len = sizeof(saddr);
+    int r = getsockname(listenfd.fdnum(), (struct sockaddr*) &saddr, &saddr_len);
+    assert(r == 0);
+    loopback.s_addr = htonl(INADDR_LOOPBACK);
+    port = ntohs(saddr.sin_port);
+
+    run(listenfd);
+    tamer::loop();
+    tamer::cleanup();
+}
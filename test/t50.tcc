@@ -0,0 +1,124 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// fd::enqueue and fd::flush: ordered delivery of many small pieces,
+// high- and low-water marks, and errors.
+
+tamed void test_order(tamer::event<> done) {
+    tvars {
+        tamer::fd a, b;
+        tamer::rendezvous<> pending;
+        std::string sent, buf = std::string(200000, 0);
+        size_t got = 0, i;
+        int ret;
+    }
+    tamer::fd::pipe(b, a);
+    b.read(&buf[0], buf.size(), got, pending.make_event());
+    // 3000 pieces, more than IOV_MAX, of sizes 1 to 97
+    for (i = 0; i != 3000; ++i) {
+        sent += std::string(1 + i % 97, 'a' + i % 26);
+        a.enqueue(std::string(1 + i % 97, 'a' + i % 26));
+    }
+    printf("queued %zu\n", a.output_queued());
+    twait { a.flush(make_event(ret)); }
+    printf("flushed %d queued %zu\n", ret, a.output_queued());
+    // pieces queued after a flush form a new drain
+    sent += std::string(100, 'z');
+    a.enqueue(std::string(100, 'z'));
+    twait { a.flush(make_event(ret)); }
+    a.close();
+    twait(pending);
+    printf("received %zu %d %s\n", got, ret,
+           buf.compare(0, got, sent) ? "bad" : "ok");
+    done();
+}
+
+tamed void test_water(tamer::event<> done) {
+    tvars {
+        tamer::fd a, b;
+        char buf[8192];
+        size_t got = 0;
+        int i = 0, ret;
+    }
+    tamer::fd::pipe(b, a);
+    a.set_output_high_water(4096);
+    while (a.enqueue(std::string(1000, 'x'))) {
+        ++i;
+    }
+    printf("high water after %d queued %zu\n", i + 1, a.output_queued());
+    twait {
+        a.at_output_low_water(make_event());
+        a.flush(make_event(ret));
+    }
+    printf("flushed %d queued %zu\n", ret, a.output_queued());
+    a.close();
+    twait { b.read(buf, sizeof(buf), got, make_event()); }
+    printf("received %zu\n", got);
+    done();
+}
+
+tamed void test_errors(tamer::event<> done) {
+    tvars {
+        tamer::fd a, b;
+        int ret1, ret2;
+        bool ok;
+    }
+    tamer::fd::pipe(b, a);
+    twait { a.flush(make_event(ret1)); }
+    printf("empty flush %d\n", ret1);
+
+    // a peer that never reads: closing the fd cancels the drain
+    a.enqueue(std::string(1 << 24, 'x'));
+    twait { tamer::at_delay_msec(10, make_event()); }
+    printf("blocked %d\n", a.output_queued() > 0);
+    twait {
+        a.flush(make_event(ret1));
+        a.at_output_low_water(make_event());
+        a.close();
+    }
+    printf("closed %d\n", ret1 == -ECANCELED);
+    printf("after close %d queued %zu\n", a.enqueue("y"), a.output_queued());
+    b.close();
+
+    // a peer that has closed: the write error is reported and sticks
+    tamer::fd::pipe(b, a);
+    b.close();
+    a.enqueue("hello");
+    twait { a.flush(make_event(ret1)); }
+    ok = a.enqueue("again");
+    twait { a.flush(make_event(ret2)); }
+    printf("epipe %d %d queued %zu enqueue %d\n", ret1 == -EPIPE,
+           ret2 == -EPIPE, a.output_queued(), ok);
+    done();
+}
+
+tamed void run() {
+    twait { test_order(make_event()); }
+    twait { test_water(make_event()); }
+    twait { test_errors(make_event()); }
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    signal(SIGPIPE, SIG_IGN);
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}
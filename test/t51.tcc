@@ -0,0 +1,160 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/capability.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <vector>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+
+// Read from a socket while fd::write_zerocopy writes to it. Zero-copy
+// completions raise an error condition on the socket; it must not wake the
+// reader. Writes are issued together, so each one's sends overlap the
+// previous one's wait for completions, and must still arrive in order.
+// Usage: t51 [-e | -l BYTES]; -e selects init_epoll_et, -l limits locked
+// memory so the kernel refuses to pin pages (ENOBUFS). A limit below one
+// write's size makes fd::write_zerocopy fall back to copying; a larger
+// one makes it wait for completions and retry.
+
+// count wakeups that report "closed" while the socket is still open
+tamed void reader(int f, tamer::event<> done) {
+    tvars { char buf[256]; ssize_t r; int ret, nspurious = 0; }
+    while (true) {
+        r = ::read(f, buf, sizeof(buf));
+        if (r == 0 || (r < 0 && errno != EAGAIN)) {
+            break;
+        } else if (r < 0) {
+            twait { tamer::at_fd_read(f, make_event(ret)); }
+            if (ret == tamer::outcome::closed
+                && ::recv(f, buf, 1, MSG_PEEK) < 0 && errno == EAGAIN) {
+                ++nspurious;
+            }
+        }
+    }
+    printf("reader eof, spurious %d\n", nspurious);
+    done();
+}
+
+tamed void writer(tamer::fd f, const std::vector<std::string>& bufs,
+                  tamer::event<> done) {
+    tvars {
+        size_t i, total = 0;
+        std::vector<size_t> n;
+        std::vector<int> ret;
+        bool ok = true;
+    }
+    n.resize(bufs.size());
+    ret.resize(bufs.size());
+    twait {
+        for (i = 0; i != bufs.size(); ++i) {
+            f.write_zerocopy(bufs[i].data(), bufs[i].length(), n[i],
+                             make_event(ret[i]));
+        }
+    }
+    for (i = 0; i != bufs.size(); ++i) {
+        ok = ok && ret[i] == 0 && n[i] == bufs[i].length();
+        total += n[i];
+    }
+    printf("wrote %zu %s\n", total, ok ? "ok" : "failed");
+    f.shutdown(SHUT_WR);
+    done();
+}
+
+// the peer trickles bytes back while reading everything
+tamed void peer(tamer::fd f, const std::string& expected, tamer::event<> done) {
+    tvars { std::string buf, got; size_t n; int i, ret; }
+    buf.resize(65536);
+    for (i = 0; i != 20; ++i) {
+        twait { f.write("p", 1, make_event()); }
+        twait { f.read_once(&buf[0], buf.length(), n, make_event(ret)); }
+        got.append(buf, 0, n);
+    }
+    do {
+        twait { f.read(&buf[0], buf.length(), n, make_event(ret)); }
+        got.append(buf, 0, n);
+    } while (n != 0);
+    printf("peer got %zu %s\n", got.length(), got == expected ? "ok" : "bad");
+    f.close();
+    done();
+}
+
+tamed void run(tamer::fd listenfd, struct in_addr addr, int port) {
+    tvars { tamer::fd a, b; std::vector<std::string> bufs; std::string all; size_t i, j; }
+
+    bufs.resize(8);
+    for (i = 0; i != bufs.size(); ++i) {
+        for (j = 0; j != 262144; ++j) {
+            bufs[i] += char('a' + (i + j) % 23);
+        }
+        all += bufs[i];
+    }
+
+    twait {
+        tamer::tcp_connect(addr, port, make_event(a));
+        listenfd.accept(make_event(b));
+    }
+    assert(a && b);
+    twait {
+        reader(a.fdnum(), make_event());
+        writer(a, bufs, make_event());
+        peer(b, all, make_event());
+    }
+    a.close();
+}
+
+// lets the memory limit apply even when running as root
+static void limit_locked_memory(rlim_t size) {
+    struct __user_cap_header_struct h = {_LINUX_CAPABILITY_VERSION_3, 0};
+    struct __user_cap_data_struct d[2];
+    if (syscall(SYS_capget, &h, d) == 0) {
+        d[0].effective &= ~(1U << CAP_IPC_LOCK);
+        syscall(SYS_capset, &h, d);
+    }
+    struct rlimit rl = {size, size};
+    setrlimit(RLIMIT_MEMLOCK, &rl);
+}
+
+int main(int argc, char** argv) {
+    int flags = 0;
+    if (argc > 1 && strcmp(argv[1], "-e") == 0) {
+        flags = tamer::init_tamer | tamer::init_epoll_et;
+    } else if (argc > 2 && strcmp(argv[1], "-l") == 0) {
+        limit_locked_memory(strtoul(argv[2], 0, 0));
+    }
+    tamer::initialize(flags);
+    signal(SIGPIPE, SIG_IGN);
+
+    tamer::fd listenfd = tamer::tcp_listen(0);
+    assert(listenfd);
+    struct sockaddr_in saddr;
+    socklen_t saddr_len = sizeof(saddr);
+    int r = getsockname(listenfd.fdnum(), (struct sockaddr*) &saddr, &saddr_len);
+    assert(r == 0);
+    saddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    run(listenfd, saddr.sin_addr, ntohs(saddr.sin_port));
+    tamer::loop();
+    tamer::cleanup();
+}
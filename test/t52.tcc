@@ -0,0 +1,90 @@
+// -*- mode: c++ -*-
+/* Copyright (c) 2026, Eddie Kohler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Tamer LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Tamer LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <sys/socket.h>
+#include <tamer/tamer.hh>
+#include <tamer/fd.hh>
+#include <tamer/http.hh>
+
+// HTTP requests and responses, plain and chunked, sent through the fd
+// output queue and parsed back with tamer::http_parser.
+
+tamed void server(tamer::fd f, tamer::event<> done) {
+    tvars {
+        tamer::http_parser hp(HTTP_REQUEST);
+        tamer::http_message req, res;
+    }
+
+    twait { hp.receive(f, make_event(req)); }
+    printf("server %s %s %s\n", http_method_str(req.method()),
+           req.url().c_str(), req.body().c_str());
+    res.status_code(200).header("Content-Type", "text/plain")
+        .body(std::string(40000, 'b'));
+    twait { hp.send(f, res, make_event()); }
+
+    twait { hp.receive(f, make_event(req)); }
+    printf("server %s %s\n", http_method_str(req.method()), req.url().c_str());
+    res.clear();
+    res.status_code(200).header("Transfer-Encoding", "chunked");
+    twait { tamer::http_parser::send_response_headers(f, res, make_event()); }
+    twait { tamer::http_parser::send_response_chunk(f, std::string(20000, 'c'), make_event()); }
+    twait { tamer::http_parser::send_response_chunk(f, "tail", make_event()); }
+    twait { tamer::http_parser::send_response_end(f, make_event()); }
+    done();
+}
+
+tamed void client(tamer::fd f, tamer::event<> done) {
+    tvars {
+        tamer::http_parser hp(HTTP_RESPONSE);
+        tamer::http_message req, res;
+    }
+
+    req.method(HTTP_POST).url("/post").header("Host", "t52").body("hello");
+    twait { hp.send(f, req, make_event()); }
+    twait { hp.receive(f, make_event(res)); }
+    printf("client %u %zu %s\n", res.status_code(), res.body().length(),
+           res.body() == std::string(40000, 'b') ? "ok" : "bad");
+
+    req.clear();
+    req.method(HTTP_GET).url("/chunked").header("Host", "t52");
+    twait { hp.send(f, req, make_event()); }
+    twait { hp.receive(f, make_event(res)); }
+    printf("client %u %zu %s\n", res.status_code(), res.body().length(),
+           res.body() == std::string(20000, 'c') + "tail" ? "ok" : "bad");
+    done();
+}
+
+tamed void run() {
+    tvars { int sv[2]; tamer::fd a, b; }
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        perror("socketpair");
+        return;
+    }
+    a = tamer::fd(sv[0]);
+    b = tamer::fd(sv[1]);
+    tamer::fd::make_nonblocking(sv[0]);
+    tamer::fd::make_nonblocking(sv[1]);
+    twait {
+        server(a, make_event());
+        client(b, make_event());
+    }
+}
+
+int main(int, char**) {
+    tamer::initialize();
+    run();
+    tamer::loop();
+    tamer::cleanup();
+}